@@ -189,6 +189,7 @@ typedef struct FCI_Int
   cab_ULONG          folders_data_size;   /* total size of data contained in the current folders */
   TCOMP              compression;
   cab_UWORD        (*compress)(struct FCI_Int *);
+  void              *zstream;             /* deflate state reused for all MSZIP blocks */
 } FCI_Int;
 
 #define FCI_INT_MAGIC 0xfcfcfc05
@@ -925,26 +926,37 @@ static void zfree( void *opaque, void *ptr )
 
 static cab_UWORD compress_MSZIP( FCI_Int *fci )
 {
-    z_stream stream;
+    z_stream *stream = fci->zstream;
 
-    stream.zalloc = zalloc;
-    stream.zfree  = zfree;
-    stream.opaque = fci;
-    if (deflateInit2( &stream, Z_DEFAULT_COMPRESSION, Z_DEFLATED, -15, 8, Z_DEFAULT_STRATEGY ) != Z_OK)
+    /* setting up the deflate state costs more than compressing a block, so keep it around */
+    if (stream) deflateReset( stream );
+    else
     {
-        set_error( fci, FCIERR_ALLOC_FAIL, ERROR_NOT_ENOUGH_MEMORY );
-        return 0;
+        if (!(stream = fci->alloc( sizeof(*stream) )))
+        {
+            set_error( fci, FCIERR_ALLOC_FAIL, ERROR_NOT_ENOUGH_MEMORY );
+            return 0;
+        }
+        stream->zalloc = zalloc;
+        stream->zfree  = zfree;
+        stream->opaque = fci;
+        if (deflateInit2( stream, Z_DEFAULT_COMPRESSION, Z_DEFLATED, -15, 8, Z_DEFAULT_STRATEGY ) != Z_OK)
+        {
+            fci->free( stream );
+            set_error( fci, FCIERR_ALLOC_FAIL, ERROR_NOT_ENOUGH_MEMORY );
+            return 0;
+        }
+        fci->zstream = stream;
     }
-    stream.next_in   = fci->data_in;
-    stream.avail_in  = fci->cdata_in;
-    stream.next_out  = fci->data_out + 2;
-    stream.avail_out = sizeof(fci->data_out) - 2;
+    stream->next_in   = fci->data_in;
+    stream->avail_in  = fci->cdata_in;
+    stream->next_out  = fci->data_out + 2;
+    stream->avail_out = sizeof(fci->data_out) - 2;
     /* insert the signature */
     fci->data_out[0] = 'C';
     fci->data_out[1] = 'K';
-    deflate( &stream, Z_FINISH );
-    deflateEnd( &stream );
-    return stream.total_out + 2;
+    deflate( stream, Z_FINISH );
+    return stream->total_out + 2;
 }
 
 #endif  /* HAVE_ZLIB */
@@ -1734,6 +1746,14 @@ BOOL __cdecl FCIDestroy(HFCI hfci)
 
     close_temp_file( p_fci_internal, &p_fci_internal->data );
 
+#ifdef HAVE_ZLIB
+    if (p_fci_internal->zstream)
+    {
+        deflateEnd( p_fci_internal->zstream );
+        p_fci_internal->free( p_fci_internal->zstream );
+    }
+#endif
+
     /* hfci can now be removed */
     p_fci_internal->free(hfci);
     return TRUE;
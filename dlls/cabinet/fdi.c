@@ -149,6 +149,9 @@ typedef struct fdi_cds_fwd {
     struct QTMstate qtm;
     struct LZXstate lzx;
   } methods;
+  /* the MSZIP fixed Huffman tables, built on first use */
+  struct Ziphuft *fixed_tl, *fixed_td;
+  cab_LONG fixed_bl, fixed_bd;
   /* some temp variables for use during decompression */
   cab_UBYTE q_length_base[27], q_length_extra[27], q_extra_bits[42];
   cab_ULONG q_position_base[42];
@@ -1124,10 +1127,20 @@ static cab_LONG fdi_Zipinflate_codes(const struct Ziphuft *tl, const struct Ziph
         e = ZIPWSIZE - max(d, w);
         e = min(e, n);
         n -= e;
-        do
+        if (d > w || w - d >= e)
+        {
+          /* the source doesn't overlap what we are writing */
+          memmove(CAB(outbuf) + w, CAB(outbuf) + d, e);
+          w += e;
+          d += e;
+        }
+        else
         {
-          CAB(outbuf)[w++] = CAB(outbuf)[d++];
-        } while (--e);
+          do
+          {
+            CAB(outbuf)[w++] = CAB(outbuf)[d++];
+          } while (--e);
+        }
       } while (n);
     }
   }
@@ -1196,6 +1209,9 @@ static cab_LONG fdi_Zipinflate_fixed(fdi_decomp_state *decomp_state)
   cab_LONG i;                /* temporary variable */
   cab_ULONG *l;
 
+  if (CAB(fixed_tl))
+    return fdi_Zipinflate_codes(CAB(fixed_tl), CAB(fixed_td), CAB(fixed_bl), CAB(fixed_bd), decomp_state);
+
   l = ZIP(ll);
 
   /* literal table */
@@ -1221,12 +1237,14 @@ static cab_LONG fdi_Zipinflate_fixed(fdi_decomp_state *decomp_state)
     return i;
   }
 
-  /* decompress until an end-of-block code */
-  i = fdi_Zipinflate_codes(fixed_tl, fixed_td, fixed_bl, fixed_bd, decomp_state);
+  /* keep them for the next fixed blocks, they are freed with decomp_state */
+  CAB(fixed_tl) = fixed_tl;
+  CAB(fixed_td) = fixed_td;
+  CAB(fixed_bl) = fixed_bl;
+  CAB(fixed_bd) = fixed_bd;
 
-  fdi_Ziphuft_free(CAB(fdi), fixed_td);
-  fdi_Ziphuft_free(CAB(fdi), fixed_tl);
-  return i;
+  /* decompress until an end-of-block code */
+  return fdi_Zipinflate_codes(fixed_tl, fixed_td, fixed_bl, fixed_bd, decomp_state);
 }
 
 /**************************************************************
@@ -1428,6 +1446,22 @@ static int ZIPfdi_decomp(int inlen, int outlen, fdi_decomp_state *decomp_state)
   return DECR_OK;
 }
 
+/********************************************************
+ * fdi_copy_match (internal)
+ *
+ * Copies a match within the window. The source may overlap the
+ * destination, in which case the bytes being written are repeated.
+ */
+static inline void fdi_copy_match(cab_UBYTE *dest, const cab_UBYTE *src, int length)
+{
+  if (src > dest || dest - src >= length)
+    memmove(dest, src, length);
+  else if (dest - src == 1)
+    memset(dest, *src, length);
+  else
+    while (length-- > 0) *dest++ = *src++;
+}
+
 /*******************************************************************
  * QTMfdi_decomp(internal)
  */
@@ -1530,14 +1564,15 @@ static int QTMfdi_decomp(int inlen, int outlen, fdi_decomp_state *decomp_state)
         if (copy_length < match_length) {
           match_length -= copy_length;
           window_posn += copy_length;
-          while (copy_length-- > 0) *rundest++ = *runsrc++;
+          fdi_copy_match(rundest, runsrc, copy_length);
+          rundest += copy_length;
           runsrc = window;
         }
       }
       window_posn += match_length;
 
       /* copy match data - no worries about destination wraps */
-      while (match_length-- > 0) *rundest++ = *runsrc++;
+      fdi_copy_match(rundest, runsrc, match_length);
     }
   } /* while (togo > 0) */
 
@@ -1768,14 +1803,15 @@ static int LZXfdi_decomp(int inlen, int outlen, fdi_decomp_state *decomp_state)
               if (copy_length < match_length) {
                 match_length -= copy_length;
                 window_posn += copy_length;
-                while (copy_length-- > 0) *rundest++ = *runsrc++;
+                fdi_copy_match(rundest, runsrc, copy_length);
+                rundest += copy_length;
                 runsrc = window;
               }
             }
             window_posn += match_length;
 
             /* copy match data - no worries about destination wraps */
-            while (match_length-- > 0) *rundest++ = *runsrc++;
+            fdi_copy_match(rundest, runsrc, match_length);
           }
         }
         break;
@@ -1857,14 +1893,15 @@ static int LZXfdi_decomp(int inlen, int outlen, fdi_decomp_state *decomp_state)
               if (copy_length < match_length) {
                 match_length -= copy_length;
                 window_posn += copy_length;
-                while (copy_length-- > 0) *rundest++ = *runsrc++;
+                fdi_copy_match(rundest, runsrc, copy_length);
+                rundest += copy_length;
                 runsrc = window;
               }
             }
             window_posn += match_length;
 
             /* copy match data - no worries about destination wraps */
-            while (match_length-- > 0) *rundest++ = *runsrc++;
+            fdi_copy_match(rundest, runsrc, match_length);
           }
         }
         break;
@@ -2245,6 +2282,8 @@ static void free_decompression_mem(FDI_Int *fdi, fdi_decomp_state *decomp_state)
       CAB(firstfile) = CAB(firstfile)->next;
       fdi->free(file);
     }
+    fdi_Ziphuft_free(fdi, CAB(fixed_td));
+    fdi_Ziphuft_free(fdi, CAB(fixed_tl));
     prev_fds = decomp_state;
     decomp_state = CAB(next);
     fdi->free(prev_fds);
@@ -818,6 +818,8 @@ BOOL WINAPI CertSetCertificateContextProperty(PCCERT_CONTEXT pCertContext,
     }
     ret = CertContext_SetProperty(cert_from_ptr(pCertContext), dwPropId, dwFlags,
      pvData);
+    if (ret)
+        Context_PropertiesChanged(&cert_from_ptr(pCertContext)->base);
     TRACE("returning %d\n", ret);
     return ret;
 }
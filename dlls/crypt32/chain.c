@@ -17,6 +17,7 @@
  *
  */
 #include <stdarg.h>
+#include <stdio.h>
 #define NONAMELESSUNION
 #include "windef.h"
 #include "winbase.h"
@@ -33,6 +34,27 @@ WINE_DECLARE_DEBUG_CHANNEL(chain);
 
 #define DEFAULT_CYCLE_MODULUS 7
 
+/* Validated chains are kept for a while, so that clients verifying the same
+ * server certificate for every connection don't have to build it again.
+ */
+#define CHAIN_CACHE_SIZE    16
+#define CHAIN_CACHE_TIMEOUT 30000 /* ms */
+
+/* revocation is always checked again, a certificate may be revoked at any time */
+#define CHAIN_CACHE_REVOCATION_FLAGS (CERT_CHAIN_REVOCATION_CHECK_END_CERT | \
+ CERT_CHAIN_REVOCATION_CHECK_CHAIN | CERT_CHAIN_REVOCATION_CHECK_CHAIN_EXCLUDE_ROOT | \
+ CERT_CHAIN_REVOCATION_CHECK_CACHE_ONLY | CERT_CHAIN_REVOCATION_ACCUMULATIVE_TIMEOUT)
+
+struct chain_cache_entry
+{
+    BYTE                 hash[20];  /* SHA1 hash of the end certificate */
+    BYTE                 additional[20]; /* see chain_cache_get_additional */
+    DWORD                flags;
+    char                *usage;     /* requested usages, see chain_cache_usage_key */
+    ULONGLONG            expires;
+    PCCERT_CHAIN_CONTEXT chain;
+};
+
 /* This represents a subset of a certificate chain engine:  it doesn't include
  * the "hOther" store described by MSDN, because I'm not sure how that's used.
  * It also doesn't include the "hTrust" store, because I don't yet implement
@@ -47,6 +69,10 @@ typedef struct _CertificateChainEngine
     DWORD      dwUrlRetrievalTimeout;
     DWORD      MaximumCachedCertificates;
     DWORD      CycleDetectionModulus;
+    CRITICAL_SECTION cs;  /* protects the chain cache */
+    struct chain_cache_entry cache[CHAIN_CACHE_SIZE];
+    unsigned int cache_next;
+    LONG cache_generation; /* of hWorld when the cached chains were built */
 } CertificateChainEngine;
 
 static inline void CRYPT_AddStoresToCollection(HCERTSTORE collection,
@@ -158,6 +184,12 @@ HCERTCHAINENGINE CRYPT_CreateChainEngine(HCERTSTORE root, DWORD system_store, co
     else
         engine->CycleDetectionModulus = DEFAULT_CYCLE_MODULUS;
 
+    InitializeCriticalSection(&engine->cs);
+    engine->cs.DebugInfo->Spare[0] = (DWORD_PTR)(__FILE__ ": CertificateChainEngine.cs");
+    memset(engine->cache, 0, sizeof(engine->cache));
+    engine->cache_next = 0;
+    engine->cache_generation = 0;
+
     return engine;
 }
 
@@ -200,9 +232,17 @@ static CertificateChainEngine *get_chain_engine(HCERTCHAINENGINE handle, BOOL al
 
 static void free_chain_engine(CertificateChainEngine *engine)
 {
+    unsigned int i;
+
     if(!engine || InterlockedDecrement(&engine->ref))
         return;
 
+    for(i = 0; i < CHAIN_CACHE_SIZE; i++) {
+        CertFreeCertificateChain(engine->cache[i].chain);
+        CryptMemFree(engine->cache[i].usage);
+    }
+    engine->cs.DebugInfo->Spare[0] = 0;
+    DeleteCriticalSection(&engine->cs);
     CertCloseStore(engine->hWorld, 0);
     CertCloseStore(engine->hRoot, 0);
     CryptMemFree(engine);
@@ -2876,11 +2916,245 @@ static void dump_chain_para(const CERT_CHAIN_PARA *pChainPara)
     }
 }
 
+/* Serializes the requested usages and issuance policies, so that only chains
+ * checked against the same requirements are returned from the cache.
+ */
+static char *chain_cache_usage_key(const CERT_CHAIN_PARA *pChainPara)
+{
+    const CERT_USAGE_MATCH *usages[2];
+    DWORD count = 0, len = 1, i, j;
+    char *key, *ptr;
+
+    if (pChainPara->cbSize >= sizeof(CERT_CHAIN_PARA_NO_EXTRA_FIELDS))
+        usages[count++] = &pChainPara->RequestedUsage;
+    if (pChainPara->cbSize >= sizeof(CERT_CHAIN_PARA))
+        usages[count++] = &pChainPara->RequestedIssuancePolicy;
+
+    for (i = 0; i < count; i++)
+    {
+        len += 12; /* type, ':' and ';' */
+        for (j = 0; j < usages[i]->Usage.cUsageIdentifier; j++)
+            len += strlen(usages[i]->Usage.rgpszUsageIdentifier[j]) + 1;
+    }
+    if (!(key = CryptMemAlloc(len)))
+        return NULL;
+
+    ptr = key;
+    for (i = 0; i < count; i++)
+    {
+        ptr += sprintf(ptr, "%u:", usages[i]->dwType);
+        for (j = 0; j < usages[i]->Usage.cUsageIdentifier; j++)
+            ptr += sprintf(ptr, "%s,", usages[i]->Usage.rgpszUsageIdentifier[j]);
+        *ptr++ = ';';
+    }
+    *ptr = 0;
+    return key;
+}
+
+static BOOL chain_cache_get_hash(PCCERT_CONTEXT cert, BYTE *hash)
+{
+    DWORD size = 20;
+
+    return CertGetCertificateContextProperty(cert, CERT_HASH_PROP_ID, hash, &size);
+}
+
+/* Identifies the content of the additional store as the SHA1 hash of the
+ * hashes of its certificates, or all zeroes without an additional store.
+ */
+static BOOL chain_cache_get_additional(HCERTSTORE store, BYTE *additional)
+{
+    PCCERT_CONTEXT cert = NULL;
+    BYTE *hashes = NULL, *ptr;
+    DWORD count = 0, size = 20;
+    BOOL ret = TRUE;
+
+    memset(additional, 0, 20);
+    if (!store) return TRUE;
+
+    while (ret && (cert = CertEnumCertificatesInStore(store, cert)))
+    {
+        ptr = hashes ? CryptMemRealloc(hashes, (count + 1) * 20) : CryptMemAlloc(20);
+        if (!ptr)
+            ret = FALSE;
+        else
+        {
+            hashes = ptr;
+            ret = chain_cache_get_hash(cert, hashes + count++ * 20);
+        }
+    }
+    CertFreeCertificateContext(cert);
+    if (ret)
+        ret = CryptHashCertificate(0, CALG_SHA1, 0, hashes, count * 20, additional, &size);
+    CryptMemFree(hashes);
+    return ret;
+}
+
+static LONG chain_cache_get_generation(CertificateChainEngine *engine)
+{
+    return engine->hWorld ? CRYPT_GetStoreGeneration(engine->hWorld) : 0;
+}
+
+static void chain_cache_flush(CertificateChainEngine *engine)
+{
+    unsigned int i;
+
+    for (i = 0; i < CHAIN_CACHE_SIZE; i++)
+    {
+        CertFreeCertificateChain(engine->cache[i].chain);
+        CryptMemFree(engine->cache[i].usage);
+        engine->cache[i].chain = NULL;
+        engine->cache[i].usage = NULL;
+    }
+}
+
+/* Returns the cached chain for cert. A chain built for another context of
+ * the same certificate is copied, so that its end element is the caller's
+ * context.
+ */
+static PCCERT_CHAIN_CONTEXT chain_cache_copy(PCCERT_CHAIN_CONTEXT cached,
+ PCCERT_CONTEXT cert)
+{
+    const CERT_SIMPLE_CHAIN *simple = cached->rgpChain[0];
+    CertificateChain *copy;
+    PCERT_SIMPLE_CHAIN copy_simple;
+    DWORD i;
+
+    if (simple->rgpElement[0]->pCertContext == cert)
+        return CertDuplicateCertificateChain(cached);
+    if (cached->cChain != 1 || cached->cLowerQualityChainContext)
+        return NULL;
+
+    copy = CRYPT_CopyChainToElement((CertificateChain *)cached, 0,
+     simple->cElement - 1);
+    if (!copy)
+        return NULL;
+    /* the copy only resets the trust status */
+    copy->context.TrustStatus = cached->TrustStatus;
+    copy->context.fHasRevocationFreshnessTime = cached->fHasRevocationFreshnessTime;
+    copy->context.dwRevocationFreshnessTime = cached->dwRevocationFreshnessTime;
+    copy_simple = copy->context.rgpChain[0];
+    copy_simple->TrustStatus = simple->TrustStatus;
+    copy_simple->fHasRevocationFreshnessTime = simple->fHasRevocationFreshnessTime;
+    copy_simple->dwRevocationFreshnessTime = simple->dwRevocationFreshnessTime;
+    for (i = 0; i < simple->cElement; i++)
+        copy_simple->rgpElement[i]->TrustStatus = simple->rgpElement[i]->TrustStatus;
+    CertFreeCertificateContext(copy_simple->rgpElement[0]->pCertContext);
+    copy_simple->rgpElement[0]->pCertContext = CertDuplicateCertificateContext(cert);
+    return &copy->context;
+}
+
+/* Returns a cached chain, if the engine's stores haven't changed since it
+ * was built, otherwise drops all of the cached chains.
+ */
+static PCCERT_CHAIN_CONTEXT chain_cache_find(CertificateChainEngine *engine,
+ LONG generation, PCCERT_CONTEXT cert, const BYTE *hash, const BYTE *additional,
+ DWORD flags, const char *usage)
+{
+    PCCERT_CHAIN_CONTEXT chain = NULL;
+    ULONGLONG now = GetTickCount64();
+    unsigned int i;
+
+    EnterCriticalSection(&engine->cs);
+    if (generation != engine->cache_generation)
+    {
+        TRACE_(chain)("engine stores changed, dropping cached chains\n");
+        chain_cache_flush(engine);
+        engine->cache_generation = generation;
+    }
+    for (i = 0; i < CHAIN_CACHE_SIZE; i++)
+    {
+        struct chain_cache_entry *entry = &engine->cache[i];
+
+        if (!entry->chain || entry->flags != flags ||
+         memcmp(entry->hash, hash, sizeof(entry->hash)) ||
+         memcmp(entry->additional, additional, sizeof(entry->additional)) ||
+         strcmp(entry->usage, usage))
+            continue;
+        if (now < entry->expires)
+            chain = chain_cache_copy(entry->chain, cert);
+        break;
+    }
+    LeaveCriticalSection(&engine->cs);
+    return chain;
+}
+
+/* Only caches chains without any error, taking ownership of usage. The
+ * chain isn't cached if the engine's stores changed while it was built.
+ */
+static void chain_cache_add(CertificateChainEngine *engine, LONG generation,
+ const BYTE *hash, const BYTE *additional, DWORD flags, char *usage,
+ PCCERT_CHAIN_CONTEXT chain)
+{
+    struct chain_cache_entry *entry;
+    ULONGLONG timeout = CHAIN_CACHE_TIMEOUT, left;
+    ULARGE_INTEGER now, not_after;
+    FILETIME ft;
+    DWORD i, j;
+
+    if (chain->TrustStatus.dwErrorStatus)
+    {
+        CryptMemFree(usage);
+        return;
+    }
+
+    /* don't keep it past the expiration of any of its certificates */
+    GetSystemTimeAsFileTime(&ft);
+    now.u.LowPart = ft.dwLowDateTime;
+    now.u.HighPart = ft.dwHighDateTime;
+    for (i = 0; i < chain->cChain; i++)
+    {
+        for (j = 0; j < chain->rgpChain[i]->cElement; j++)
+        {
+            const FILETIME *time = &chain->rgpChain[i]->rgpElement[j]->pCertContext->pCertInfo->NotAfter;
+
+            not_after.u.LowPart = time->dwLowDateTime;
+            not_after.u.HighPart = time->dwHighDateTime;
+            left = not_after.QuadPart > now.QuadPart ? (not_after.QuadPart - now.QuadPart) / 10000 : 0;
+            timeout = min(timeout, left);
+        }
+    }
+
+    EnterCriticalSection(&engine->cs);
+    if (generation != engine->cache_generation ||
+     generation != chain_cache_get_generation(engine))
+    {
+        LeaveCriticalSection(&engine->cs);
+        CryptMemFree(usage);
+        return;
+    }
+    for (i = 0; i < CHAIN_CACHE_SIZE; i++)
+    {
+        entry = &engine->cache[i];
+        if (entry->chain && entry->flags == flags &&
+         !memcmp(entry->hash, hash, sizeof(entry->hash)) &&
+         !memcmp(entry->additional, additional, sizeof(entry->additional)) &&
+         !strcmp(entry->usage, usage))
+            break;
+    }
+    if (i == CHAIN_CACHE_SIZE)
+    {
+        entry = &engine->cache[engine->cache_next];
+        engine->cache_next = (engine->cache_next + 1) % CHAIN_CACHE_SIZE;
+    }
+    CertFreeCertificateChain(entry->chain);
+    CryptMemFree(entry->usage);
+    memcpy(entry->hash, hash, sizeof(entry->hash));
+    memcpy(entry->additional, additional, sizeof(entry->additional));
+    entry->flags = flags;
+    entry->usage = usage;
+    entry->expires = GetTickCount64() + timeout;
+    entry->chain = CertDuplicateCertificateChain(chain);
+    LeaveCriticalSection(&engine->cs);
+}
+
 BOOL WINAPI CertGetCertificateChain(HCERTCHAINENGINE hChainEngine,
  PCCERT_CONTEXT pCertContext, LPFILETIME pTime, HCERTSTORE hAdditionalStore,
  PCERT_CHAIN_PARA pChainPara, DWORD dwFlags, LPVOID pvReserved,
  PCCERT_CHAIN_CONTEXT* ppChainContext)
 {
+    char *usage = NULL;
+    BYTE hash[20], additional[20];
+    LONG generation = 0;
     CertificateChainEngine *engine;
     BOOL ret;
     CertificateChain *chain = NULL;
@@ -2908,6 +3182,26 @@ BOOL WINAPI CertGetCertificateChain(HCERTCHAINENGINE hChainEngine,
 
     if (TRACE_ON(chain))
         dump_chain_para(pChainPara);
+
+    /* the cache only holds chains validated at the current time, and never
+     * answers revocation checks */
+    if (!pTime && ppChainContext && !(dwFlags & CHAIN_CACHE_REVOCATION_FLAGS) &&
+     (pChainPara->cbSize < sizeof(CERT_CHAIN_PARA) ||
+     (!pChainPara->fCheckRevocationFreshnessTime && !pChainPara->pftCacheResync)) &&
+     chain_cache_get_hash(pCertContext, hash) &&
+     chain_cache_get_additional(hAdditionalStore, additional) &&
+     (usage = chain_cache_usage_key(pChainPara)))
+    {
+        generation = chain_cache_get_generation(engine);
+        if ((*ppChainContext = chain_cache_find(engine, generation, pCertContext,
+         hash, additional, dwFlags, usage)))
+        {
+            TRACE_(chain)("using cached chain %p\n", *ppChainContext);
+            CryptMemFree(usage);
+            return TRUE;
+        }
+    }
+
     /* FIXME: what about HCCE_LOCAL_MACHINE? */
     ret = CRYPT_BuildCandidateChainFromCert(engine, pCertContext, pTime,
      hAdditionalStore, dwFlags, &chain);
@@ -2936,11 +3230,18 @@ BOOL WINAPI CertGetCertificateChain(HCERTCHAINENGINE hChainEngine,
         CRYPT_CheckUsages(pChain, pChainPara);
         TRACE_(chain)("error status: %08x\n",
          pChain->TrustStatus.dwErrorStatus);
+        if (usage)
+        {
+            chain_cache_add(engine, generation, hash, additional, dwFlags, usage,
+             pChain);
+            usage = NULL;
+        }
         if (ppChainContext)
             *ppChainContext = pChain;
         else
             CertFreeCertificateChain(pChain);
     }
+    CryptMemFree(usage);
     TRACE("returning %d\n", ret);
     return ret;
 }
@@ -486,6 +486,20 @@ WINECRYPT_CERTSTORE *CRYPT_CollectionOpenStore(HCRYPTPROV hCryptProv,
     return (WINECRYPT_CERTSTORE*)store;
 }
 
+LONG CRYPT_CollectionGetGeneration(WINECRYPT_CERTSTORE *cert_store)
+{
+    WINE_COLLECTIONSTORE *store = (WINE_COLLECTIONSTORE*)cert_store;
+    WINE_STORE_LIST_ENTRY *entry;
+    LONG generation;
+
+    EnterCriticalSection(&store->cs);
+    generation = store->hdr.generation;
+    LIST_FOR_EACH_ENTRY(entry, &store->stores, WINE_STORE_LIST_ENTRY, entry)
+        generation += CRYPT_GetStoreGeneration(entry->store);
+    LeaveCriticalSection(&store->cs);
+    return generation;
+}
+
 BOOL WINAPI CertAddStoreToCollection(HCERTSTORE hCollectionStore,
  HCERTSTORE hSiblingStore, DWORD dwUpdateFlags, DWORD dwPriority)
 {
@@ -545,6 +559,7 @@ BOOL WINAPI CertAddStoreToCollection(HCERTSTORE hCollectionStore,
         }
         else
             list_add_tail(&collection->stores, &entry->entry);
+        collection->hdr.generation++;
         LeaveCriticalSection(&collection->cs);
         ret = TRUE;
     }
@@ -581,6 +596,8 @@ void WINAPI CertRemoveStoreFromCollection(HCERTSTORE hCollectionStore,
     {
         if (store->store == sibling)
         {
+            /* keep the collection's generation from going back */
+            collection->hdr.generation += CRYPT_GetStoreGeneration(sibling) + 1;
             list_remove(&store->entry);
             CertCloseStore(store->store, 0);
             CryptMemFree(store);
@@ -120,6 +120,12 @@ void Context_Release(context_t *context)
     }
 }
 
+void Context_PropertiesChanged(context_t *context)
+{
+    for (; context; context = context->linked)
+        InterlockedIncrement(&context->store->generation);
+}
+
 void Context_CopyProperties(const void *to, const void *from)
 {
     CONTEXT_PROPERTY_LIST *toProperties, *fromProperties;
@@ -314,18 +314,22 @@ typedef struct WINE_CRYPTCERTSTORE
     CertStoreType               type;
     const store_vtbl_t         *vtbl;
     CONTEXT_PROPERTY_LIST      *properties;
+    LONG                        generation; /* bumped when contexts are added, removed or changed */
 } WINECRYPT_CERTSTORE;
 
 void CRYPT_InitStore(WINECRYPT_CERTSTORE *store, DWORD dwFlags,
  CertStoreType type, const store_vtbl_t*) DECLSPEC_HIDDEN;
 void CRYPT_FreeStore(WINECRYPT_CERTSTORE *store) DECLSPEC_HIDDEN;
+LONG CRYPT_GetStoreGeneration(WINECRYPT_CERTSTORE *store) DECLSPEC_HIDDEN;
 BOOL WINAPI I_CertUpdateStore(HCERTSTORE store1, HCERTSTORE store2, DWORD unk0,
  DWORD unk1) DECLSPEC_HIDDEN;
 
 WINECRYPT_CERTSTORE *CRYPT_CollectionOpenStore(HCRYPTPROV hCryptProv,
  DWORD dwFlags, const void *pvPara) DECLSPEC_HIDDEN;
+LONG CRYPT_CollectionGetGeneration(WINECRYPT_CERTSTORE *store) DECLSPEC_HIDDEN;
 WINECRYPT_CERTSTORE *CRYPT_ProvCreateStore(DWORD dwFlags,
  WINECRYPT_CERTSTORE *memStore, const CERT_STORE_PROV_INFO *pProvInfo) DECLSPEC_HIDDEN;
+LONG CRYPT_ProvGetGeneration(WINECRYPT_CERTSTORE *store) DECLSPEC_HIDDEN;
 WINECRYPT_CERTSTORE *CRYPT_ProvOpenStore(LPCSTR lpszStoreProvider,
  DWORD dwEncodingType, HCRYPTPROV hCryptProv, DWORD dwFlags,
  const void *pvPara) DECLSPEC_HIDDEN;
@@ -410,6 +414,11 @@ void Context_AddRef(context_t*) DECLSPEC_HIDDEN;
 void Context_Release(context_t *context) DECLSPEC_HIDDEN;
 void Context_Free(context_t*) DECLSPEC_HIDDEN;
 
+/* Bumps the generation of the stores holding context, and of the stores
+ * holding the context it's linked to, see CRYPT_GetStoreGeneration.
+ */
+void Context_PropertiesChanged(context_t *context) DECLSPEC_HIDDEN;
+
 /**
  *  Context property list functions
  */
@@ -304,6 +304,14 @@ static const store_vtbl_t ProvStoreVtbl = {
     }
 };
 
+LONG CRYPT_ProvGetGeneration(WINECRYPT_CERTSTORE *cert_store)
+{
+    WINE_PROVIDERSTORE *store = (WINE_PROVIDERSTORE*)cert_store;
+
+    /* the provider's contexts are all kept in the memory store */
+    return CRYPT_GetStoreGeneration(store->memStore);
+}
+
 WINECRYPT_CERTSTORE *CRYPT_ProvCreateStore(DWORD dwFlags,
  WINECRYPT_CERTSTORE *memStore, const CERT_STORE_PROV_INFO *pProvInfo)
 {
@@ -96,6 +96,7 @@ void CRYPT_InitStore(WINECRYPT_CERTSTORE *store, DWORD dwFlags, CertStoreType ty
     store->dwOpenFlags = dwFlags;
     store->vtbl = vtbl;
     store->properties = NULL;
+    store->generation = 0;
 }
 
 void CRYPT_FreeStore(WINECRYPT_CERTSTORE *store)
@@ -106,6 +107,23 @@ void CRYPT_FreeStore(WINECRYPT_CERTSTORE *store)
     CryptMemFree(store);
 }
 
+/* Returns a value that changes whenever contexts are added to or removed from
+ * the store, or certificate properties are set, including the stores a
+ * collection or provider store is made of.
+ */
+LONG CRYPT_GetStoreGeneration(WINECRYPT_CERTSTORE *store)
+{
+    switch (store->type)
+    {
+    case StoreTypeCollection:
+        return CRYPT_CollectionGetGeneration(store);
+    case StoreTypeProvider:
+        return CRYPT_ProvGetGeneration(store);
+    default:
+        return store->generation;
+    }
+}
+
 BOOL WINAPI I_CertUpdateStore(HCERTSTORE store1, HCERTSTORE store2, DWORD unk0,
  DWORD unk1)
 {
@@ -165,6 +183,7 @@ static BOOL MemStore_addContext(WINE_MEMSTORE *store, struct list *list, context
     }else {
         list_add_head(list, &context->u.entry);
     }
+    store->hdr.generation++;
     LeaveCriticalSection(&store->cs);
 
     if(ret_context)
@@ -206,6 +225,7 @@ static BOOL MemStore_deleteContext(WINE_MEMSTORE *store, context_t *context)
     if (!list_empty(&context->u.entry)) {
         list_remove(&context->u.entry);
         list_init(&context->u.entry);
+        store->hdr.generation++;
         in_list = TRUE;
     }
     LeaveCriticalSection(&store->cs);
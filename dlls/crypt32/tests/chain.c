@@ -4923,6 +4923,124 @@ static void testVerifyCertChainPolicy(void)
      basicConstraintsPolicyCheck, &oct2007, NULL);
 }
 
+static void test_chain_cache(void)
+{
+    static const WCHAR subjectW[] = {'C','N','=','c','h','a','i','n',' ','c','a','c','h','e',0};
+    static const WCHAR nameW[] = {'n','a','m','e',0};
+    CERT_CHAIN_ENGINE_CONFIG config = { sizeof(config) };
+    CERT_CHAIN_PARA para = { sizeof(para) };
+    PCCERT_CHAIN_CONTEXT chain, chain2;
+    PCCERT_CONTEXT cert, cert2, root_cert;
+    CRYPT_DATA_BLOB name_blob;
+    CERT_NAME_BLOB subject;
+    HCERTCHAINENGINE engine;
+    HCERTSTORE root;
+    BYTE name[128];
+    DWORD size;
+    BOOL ret;
+
+    if (!pCertCreateCertificateChainEngine || !pCertFreeCertificateChainEngine)
+    {
+        win_skip("Cert*CertificateChainEngine functions not available\n");
+        return;
+    }
+
+    size = sizeof(name);
+    ret = CertStrToNameW(X509_ASN_ENCODING, subjectW, CERT_X500_NAME_STR, NULL, name, &size, NULL);
+    ok(ret, "CertStrToName failed: %08x\n", GetLastError());
+    subject.pbData = name;
+    subject.cbData = size;
+    cert = CertCreateSelfSignCertificate(0, &subject, 0, NULL, NULL, NULL, NULL, NULL);
+    if (!cert)
+    {
+        skip("CertCreateSelfSignCertificate failed: %08x\n", GetLastError());
+        return;
+    }
+
+    root = CertOpenStore(CERT_STORE_PROV_MEMORY, 0, 0, CERT_STORE_CREATE_NEW_FLAG, NULL);
+    ret = CertAddCertificateContextToStore(root, cert, CERT_STORE_ADD_ALWAYS, &root_cert);
+    ok(ret, "CertAddCertificateContextToStore failed: %08x\n", GetLastError());
+    config.hExclusiveRoot = root;
+    if (!pCertCreateCertificateChainEngine(&config, &engine))
+    {
+        skip("Couldn't create chain engine\n");
+        CertFreeCertificateContext(root_cert);
+        CertFreeCertificateContext(cert);
+        CertCloseStore(root, 0);
+        return;
+    }
+
+    ret = pCertGetCertificateChain(engine, cert, NULL, NULL, &para, 0, NULL, &chain);
+    ok(ret, "CertGetCertificateChain failed: %08x\n", GetLastError());
+    if (!ret || chain->TrustStatus.dwErrorStatus)
+    {
+        skip("chain has errors %08x\n", ret ? chain->TrustStatus.dwErrorStatus : 0);
+        if (ret) pCertFreeCertificateChain(chain);
+        goto done;
+    }
+
+    /* validated chains are kept for a while */
+    ret = pCertGetCertificateChain(engine, cert, NULL, NULL, &para, 0, NULL, &chain2);
+    ok(ret, "CertGetCertificateChain failed: %08x\n", GetLastError());
+    ok(chain2 == chain || broken(chain2 != chain) /* no cache */, "chain wasn't cached\n");
+    ok(!chain2->TrustStatus.dwErrorStatus, "got error %08x\n", chain2->TrustStatus.dwErrorStatus);
+    pCertFreeCertificateChain(chain2);
+
+    /* the end element is the caller's context */
+    cert2 = CertCreateCertificateContext(X509_ASN_ENCODING, cert->pbCertEncoded, cert->cbCertEncoded);
+    ok(cert2 != NULL, "CertCreateCertificateContext failed: %08x\n", GetLastError());
+    ret = pCertGetCertificateChain(engine, cert2, NULL, NULL, &para, 0, NULL, &chain2);
+    ok(ret, "CertGetCertificateChain failed: %08x\n", GetLastError());
+    ok(chain2 != chain, "got the chain of another context\n");
+    ok(chain2->rgpChain[0]->rgpElement[0]->pCertContext == cert2, "got context %p, expected %p\n",
+       chain2->rgpChain[0]->rgpElement[0]->pCertContext, cert2);
+    ok(!chain2->TrustStatus.dwErrorStatus, "got error %08x\n", chain2->TrustStatus.dwErrorStatus);
+    ok(chain2->TrustStatus.dwInfoStatus == chain->TrustStatus.dwInfoStatus, "got info %08x, expected %08x\n",
+       chain2->TrustStatus.dwInfoStatus, chain->TrustStatus.dwInfoStatus);
+    pCertFreeCertificateChain(chain2);
+    CertFreeCertificateContext(cert2);
+
+    /* revocation is always checked */
+    ret = pCertGetCertificateChain(engine, cert, NULL, NULL, &para,
+     CERT_CHAIN_REVOCATION_CHECK_END_CERT, NULL, &chain2);
+    ok(ret, "CertGetCertificateChain failed: %08x\n", GetLastError());
+    ok(chain2 != chain, "got a cached chain\n");
+    pCertFreeCertificateChain(chain2);
+
+    /* changing a certificate's properties drops the cached chains */
+    name_blob.pbData = (BYTE *)nameW;
+    name_blob.cbData = sizeof(nameW);
+    ret = CertSetCertificateContextProperty(root_cert, CERT_FRIENDLY_NAME_PROP_ID, 0, &name_blob);
+    ok(ret, "CertSetCertificateContextProperty failed: %08x\n", GetLastError());
+    ret = pCertGetCertificateChain(engine, cert, NULL, NULL, &para, 0, NULL, &chain2);
+    ok(ret, "CertGetCertificateChain failed: %08x\n", GetLastError());
+    ok(chain2 != chain, "got a cached chain\n");
+    pCertFreeCertificateChain(chain);
+    chain = chain2;
+
+    ret = pCertGetCertificateChain(engine, cert, NULL, NULL, &para, 0, NULL, &chain2);
+    ok(ret, "CertGetCertificateChain failed: %08x\n", GetLastError());
+    ok(chain2 == chain || broken(chain2 != chain) /* no cache */, "chain wasn't cached\n");
+    pCertFreeCertificateChain(chain2);
+
+    /* so does adding a certificate to the engine's stores */
+    ret = CertAddEncodedCertificateToStore(root, X509_ASN_ENCODING, selfSignedCert,
+     sizeof(selfSignedCert), CERT_STORE_ADD_ALWAYS, NULL);
+    ok(ret, "CertAddEncodedCertificateToStore failed: %08x\n", GetLastError());
+    ret = pCertGetCertificateChain(engine, cert, NULL, NULL, &para, 0, NULL, &chain2);
+    ok(ret, "CertGetCertificateChain failed: %08x\n", GetLastError());
+    ok(chain2 != chain, "got a cached chain\n");
+    ok(!chain2->TrustStatus.dwErrorStatus, "got error %08x\n", chain2->TrustStatus.dwErrorStatus);
+    pCertFreeCertificateChain(chain2);
+    pCertFreeCertificateChain(chain);
+
+done:
+    pCertFreeCertificateChainEngine(engine);
+    CertFreeCertificateContext(root_cert);
+    CertFreeCertificateContext(cert);
+    CertCloseStore(root, 0);
+}
+
 START_TEST(chain)
 {
     HMODULE hCrypt32 = GetModuleHandleA("crypt32.dll");
@@ -4942,5 +5060,6 @@ START_TEST(chain)
         testVerifyCertChainPolicy();
         testGetCertChain();
         test_CERT_CHAIN_PARA_cbSize();
+        test_chain_cache();
     }
 }
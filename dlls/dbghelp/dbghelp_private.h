@@ -340,6 +340,8 @@ struct module_format
                                                const struct module_format* modfmt,
                                                const struct symt_function* func,
                                                struct location* loc);
+    /* loads deferred information covering addr, or all of it if addr is NULL */
+    void                        (*load_units)(struct module_format* modfmt, const DWORD_PTR* addr);
     union
     {
         struct elf_module_info*         elf_info;
@@ -373,6 +375,15 @@ struct module
     unsigned                    num_symbols;
     unsigned                    sorttab_size;
     struct symt_ht**            addr_sorttab;
+    DWORD64*                    sorttab_addr;   /* addresses of the addr_sorttab entries */
+    unsigned                    sorttab_addr_size;
+    struct
+    {
+        DWORD64                 start;          /* addresses in ]start, end[ resolve to symt */
+        DWORD64                 end;
+        struct symt_ht*         symt;
+    }                           nearest_cache[4];
+    unsigned                    nearest_cache_next;
     struct hash_table           ht_symbols;
 
     /* types */
@@ -384,6 +395,12 @@ struct module
     unsigned                    sources_alloc;
     char*                       sources;
     struct wine_rb_tree         sources_offsets_tree;
+
+    /* persistent symbol index */
+    const void*                 symcache;
+    struct symt_ht**            symcache_syms;
+    unsigned short              symcache_checked : 1,
+                                symcache_saved : 1;
 };
 
 struct process 
@@ -636,6 +653,9 @@ extern struct module*
                     module_is_already_loaded(const struct process* pcs,
                                              const WCHAR* imgname) DECLSPEC_HIDDEN;
 extern BOOL         module_get_debug(struct module_pair*) DECLSPEC_HIDDEN;
+extern BOOL         module_get_debug_at(struct module_pair*, DWORD_PTR addr) DECLSPEC_HIDDEN;
+extern struct module*
+                    module_get_container(const struct process* pcs, const struct module* inner) DECLSPEC_HIDDEN;
 extern struct module*
                     module_new(struct process* pcs, const WCHAR* name,
                                enum module_type type, BOOL virtual,
@@ -702,6 +722,9 @@ extern BOOL         stabs_parse(struct module* module, unsigned long load_offset
 extern BOOL         dwarf2_parse(struct module* module, unsigned long load_offset,
                                  const struct elf_thunk_area* thunks,
                                  struct image_file_map* fmap) DECLSPEC_HIDDEN;
+extern BOOL         dwarf2_defer_symbol(struct module* module, struct symt_compiland* compiland,
+                                        const char* name, DWORD_PTR addr, unsigned long size,
+                                        BOOL is_data, BOOL is_static) DECLSPEC_HIDDEN;
 extern BOOL dwarf2_virtual_unwind(struct cpu_stack_walk *csw, DWORD_PTR ip,
     union ctx *ctx, DWORD64 *cfa) DECLSPEC_HIDDEN;
 
@@ -711,6 +734,12 @@ extern DWORD64      sw_xlat_addr(struct cpu_stack_walk* csw, ADDRESS64* addr) DE
 extern void*        sw_table_access(struct cpu_stack_walk* csw, DWORD64 addr) DECLSPEC_HIDDEN;
 extern DWORD64      sw_module_base(struct cpu_stack_walk* csw, DWORD64 addr) DECLSPEC_HIDDEN;
 
+/* symcache.c */
+extern struct symt_ht* symcache_find_symbol(struct module_pair* pair, DWORD64 addr) DECLSPEC_HIDDEN;
+extern BOOL         symcache_needs_save(struct module* module) DECLSPEC_HIDDEN;
+extern void         symcache_save(struct module* module) DECLSPEC_HIDDEN;
+extern void         symcache_close(struct module* module) DECLSPEC_HIDDEN;
+
 /* symbol.c */
 extern const char*  symt_get_name(const struct symt* sym) DECLSPEC_HIDDEN;
 extern WCHAR*       symt_get_nameW(const struct symt* sym) DECLSPEC_HIDDEN;
@@ -201,12 +201,40 @@ typedef struct dwarf2_parse_context_s
 } dwarf2_parse_context_t;
 
 /* stored in the dbghelp's module internal structure for later reuse */
+/* a compilation unit whose content is loaded on first use */
+struct dwarf2_unit
+{
+    const unsigned char*        start;          /* unit header in .debug_info */
+    unsigned long               low_pc;         /* range of code covered by the unit */
+    unsigned long               high_pc;
+    BOOL                        loaded;
+    struct vector               deferred;       /* symtab symbols to add once loaded */
+};
+
+/* a symbol from the image's symbol table, within the range of a pending unit */
+struct dwarf2_deferred_symbol
+{
+    struct symt_compiland*      compiland;
+    const char*                 name;
+    unsigned long               address;
+    unsigned long               size;
+    BOOL                        is_data;
+    BOOL                        is_static;
+};
+
 struct dwarf2_module_info_s
 {
     dwarf2_section_t            debug_loc;
     dwarf2_section_t            debug_frame;
     dwarf2_section_t            eh_frame;
     unsigned char               word_size;
+    /* what's needed to load the pending compilation units */
+    dwarf2_section_t            sections[section_max];
+    const struct elf_thunk_area*thunks;
+    unsigned long               load_offset;
+    struct dwarf2_unit*         units;
+    unsigned                    num_units;
+    unsigned                    num_pending;
 };
 
 #define loc_dwarf2_location_list        (loc_user + 0)
@@ -2469,6 +2497,213 @@ static BOOL dwarf2_parse_compilation_unit(const dwarf2_section_t* sections,
     return ret;
 }
 
+/******************************************************************
+ *		dwarf2_scan_compilation_unit
+ *
+ * Only reads the attributes of the compilation unit's top entry, so that
+ * the unit can be loaded once an address within its range is looked up.
+ */
+static void dwarf2_scan_compilation_unit(const dwarf2_section_t* sections,
+                                         struct module* module,
+                                         dwarf2_traverse_context_t* mod_ctx,
+                                         struct dwarf2_unit* unit)
+{
+    dwarf2_parse_context_t ctx;
+    dwarf2_traverse_context_t abbrev_ctx;
+    dwarf2_traverse_context_t cu_ctx;
+    dwarf2_debug_info_t di;
+    dwarf2_abbrev_entry_attr_t* attr;
+    struct attribute stmt_list;
+    unsigned long cu_length;
+    unsigned short cu_version;
+    unsigned long cu_abbrev_offset;
+    unsigned long entry_code;
+    unsigned i;
+
+    unit->start = mod_ctx->data;
+    unit->low_pc = unit->high_pc = 0;
+    unit->loaded = FALSE;
+    vector_init(&unit->deferred, sizeof(struct dwarf2_deferred_symbol), 16);
+
+    cu_length = dwarf2_parse_u4(mod_ctx);
+    cu_ctx.data = mod_ctx->data;
+    cu_ctx.end_data = mod_ctx->data + cu_length;
+    mod_ctx->data += cu_length;
+    cu_version = dwarf2_parse_u2(&cu_ctx);
+    cu_abbrev_offset = dwarf2_parse_u4(&cu_ctx);
+    cu_ctx.word_size = dwarf2_parse_byte(&cu_ctx);
+
+    if (cu_version != 2)
+    {
+        WARN("%u DWARF version unsupported. Wine dbghelp only support DWARF 2.\n",
+             cu_version);
+        unit->loaded = TRUE;
+        return;
+    }
+
+    module->format_info[DFI_DWARF]->u.dwarf2_info->word_size = cu_ctx.word_size;
+
+    pool_init(&ctx.pool, 4096);
+    ctx.sections = sections;
+    ctx.section = section_debug;
+    ctx.module = module;
+    ctx.ref_offset = unit->start - sections[section_debug].address;
+    sparse_array_init(&ctx.debug_info_table, sizeof(dwarf2_debug_info_t), 4);
+
+    abbrev_ctx.data = sections[section_abbrev].address + cu_abbrev_offset;
+    abbrev_ctx.end_data = sections[section_abbrev].address + sections[section_abbrev].size;
+    abbrev_ctx.word_size = cu_ctx.word_size;
+    dwarf2_parse_abbrev_set(&abbrev_ctx, &ctx.abbrev_table, &ctx.pool);
+
+    entry_code = dwarf2_leb128_as_unsigned(&cu_ctx);
+    if (entry_code && (di.abbrev = dwarf2_abbrev_table_find_entry(&ctx.abbrev_table, entry_code)) &&
+        di.abbrev->tag == DW_TAG_compile_unit)
+    {
+        di.symt = NULL;
+        di.parent = NULL;
+        di.data = pool_alloc(&ctx.pool, (di.abbrev->num_attr + 1) * sizeof(const unsigned char*));
+        for (i = 0, attr = di.abbrev->attrs; attr; i++, attr = attr->next)
+        {
+            di.data[i] = cu_ctx.data;
+            dwarf2_swallow_attribute(&cu_ctx, attr);
+        }
+        if (!dwarf2_read_range(&ctx, &di, &unit->low_pc, &unit->high_pc))
+            unit->low_pc = unit->high_pc = 0;
+        if (dwarf2_find_attribute(&ctx, &di, DW_AT_stmt_list, &stmt_list))
+            module->module.LineNumbers = TRUE;
+    }
+    TRACE("unit at 0x%x covers %lx-%lx\n",
+          (int)(unit->start - sections[section_debug].address), unit->low_pc, unit->high_pc);
+    pool_destroy(&ctx.pool);
+}
+
+static inline BOOL dwarf2_unit_covers(const struct dwarf2_module_info_s* info,
+                                      const struct dwarf2_unit* unit, DWORD_PTR addr)
+{
+    return addr >= info->load_offset + unit->low_pc && addr < info->load_offset + unit->high_pc;
+}
+
+/******************************************************************
+ *		dwarf2_add_deferred_symbols
+ *
+ * Creates the symbols from the symbol table which were waiting for the unit
+ * covering them, unless the unit already provided a symbol at that address.
+ */
+static void dwarf2_add_deferred_symbols(struct module* module, struct dwarf2_unit* unit)
+{
+    struct dwarf2_deferred_symbol* ds;
+    struct symt_ht* symt;
+    struct location loc;
+    ULONG64 ref_addr;
+    unsigned i;
+
+    for (i = 0; i < vector_length(&unit->deferred); i++)
+    {
+        ds = vector_at(&unit->deferred, i);
+        symt = symt_find_nearest(module, ds->address);
+        if (symt && !symt_get_address(&symt->symt, &ref_addr))
+            ref_addr = ds->address;
+        if (symt && ref_addr == ds->address) continue;
+
+        if (ds->is_data)
+        {
+            loc.kind = loc_absolute;
+            loc.reg = 0;
+            loc.offset = ds->address;
+            symt_new_global_variable(module, ds->compiland, ds->name, ds->is_static,
+                                     loc, ds->size, NULL);
+        }
+        else
+            symt_new_function(module, ds->compiland, ds->name, ds->address, ds->size, NULL);
+        /* as in elf_new_wine_thunks, only resort once all the symbols are added */
+        module->sortlist_valid = TRUE;
+    }
+    module->sortlist_valid = FALSE;
+}
+
+static void dwarf2_load_unit(struct module_format* modfmt, struct dwarf2_unit* unit)
+{
+    struct dwarf2_module_info_s* info = modfmt->u.dwarf2_info;
+    dwarf2_traverse_context_t mod_ctx;
+    unsigned char word_size = info->word_size;
+
+    unit->loaded = TRUE;
+    info->num_pending--;
+
+    mod_ctx.data = unit->start;
+    mod_ctx.end_data = info->sections[section_debug].address + info->sections[section_debug].size;
+    mod_ctx.word_size = 0;
+    dwarf2_parse_compilation_unit(info->sections, modfmt->module, info->thunks,
+                                  &mod_ctx, info->load_offset);
+    /* restore the word size used for parsing eh_frame */
+    info->word_size = word_size;
+    dwarf2_add_deferred_symbols(modfmt->module, unit);
+}
+
+/******************************************************************
+ *		dwarf2_load_units
+ *
+ * Loads the pending compilation units covering addr, or all of them
+ * when addr is NULL or isn't covered by any unit (e.g. data).
+ */
+static void dwarf2_load_units(struct module_format* modfmt, const DWORD_PTR* addr)
+{
+    struct dwarf2_module_info_s* info = modfmt->u.dwarf2_info;
+    BOOL covered = FALSE;
+    unsigned i;
+
+    if (!info->num_pending) return;
+
+    if (addr)
+    {
+        for (i = 0; i < info->num_units; i++)
+        {
+            if (!dwarf2_unit_covers(info, &info->units[i], *addr)) continue;
+            covered = TRUE;
+            if (!info->units[i].loaded) dwarf2_load_unit(modfmt, &info->units[i]);
+        }
+        if (covered) return;
+    }
+
+    TRACE("loading %u pending units for %s\n", info->num_pending,
+          debugstr_w(modfmt->module->module.ModuleName));
+    for (i = 0; i < info->num_units; i++)
+    {
+        if (!info->units[i].loaded) dwarf2_load_unit(modfmt, &info->units[i]);
+    }
+}
+
+/******************************************************************
+ *		dwarf2_defer_symbol
+ *
+ * If a pending unit covers addr, keeps the symbol table entry with that unit
+ * and creates the symbol when the unit is loaded.
+ */
+BOOL dwarf2_defer_symbol(struct module* module, struct symt_compiland* compiland,
+                         const char* name, DWORD_PTR addr, unsigned long size,
+                         BOOL is_data, BOOL is_static)
+{
+    const struct module_format* modfmt = module->format_info[DFI_DWARF];
+    struct dwarf2_module_info_s* info;
+    struct dwarf2_deferred_symbol* ds;
+    unsigned i;
+
+    if (!modfmt || !(info = modfmt->u.dwarf2_info)->num_pending) return FALSE;
+    for (i = 0; i < info->num_units; i++)
+    {
+        if (info->units[i].loaded || !dwarf2_unit_covers(info, &info->units[i], addr)) continue;
+        if (!(ds = vector_add(&info->units[i].deferred, &module->pool))) return FALSE;
+        ds->compiland = compiland;
+        ds->name      = pool_strdup(&module->pool, name);
+        ds->address   = addr;
+        ds->size      = size;
+        ds->is_data   = is_data;
+        ds->is_static = is_static;
+        return TRUE;
+    }
+    return FALSE;
+}
+
 static BOOL dwarf2_lookup_loclist(const struct module_format* modfmt, const BYTE* start,
                                   unsigned long ip, dwarf2_traverse_context_t* lctx)
 {
@@ -3259,7 +3494,7 @@ BOOL dwarf2_virtual_unwind(struct cpu_stack_walk *csw, ULONG_PTR ip,
 
     if (!(pair.pcs = process_find_by_handle(csw->hProcess)) ||
         !(pair.requested = module_find_by_addr(pair.pcs, ip, DMT_UNKNOWN)) ||
-        !module_get_debug(&pair))
+        !module_get_debug_at(&pair, ip))
         return FALSE;
     modfmt = pair.effective->format_info[DFI_DWARF];
     if (!modfmt) return FALSE;
@@ -3500,8 +3735,16 @@ static inline void dwarf2_fini_section(dwarf2_section_t* section)
 
 static void dwarf2_module_remove(struct process* pcs, struct module_format* modfmt)
 {
+    unsigned i;
+
     dwarf2_fini_section(&modfmt->u.dwarf2_info->debug_loc);
     dwarf2_fini_section(&modfmt->u.dwarf2_info->debug_frame);
+    if (modfmt->u.dwarf2_info->units)
+    {
+        for (i = 0; i < section_max; i++)
+            dwarf2_fini_section(&modfmt->u.dwarf2_info->sections[i]);
+        HeapFree(GetProcessHeap(), 0, modfmt->u.dwarf2_info->units);
+    }
     HeapFree(GetProcessHeap(), 0, modfmt);
 }
 
@@ -3513,8 +3756,10 @@ BOOL dwarf2_parse(struct module* module, unsigned long load_offset,
     dwarf2_traverse_context_t   mod_ctx;
     struct image_section_map    debug_sect, debug_str_sect, debug_abbrev_sect,
                                 debug_line_sect, debug_ranges_sect, eh_frame_sect;
-    BOOL                ret = TRUE;
+    BOOL                ret = TRUE, lazy, keep_sections = FALSE;
     struct module_format* dwarf2_modfmt;
+    struct dwarf2_module_info_s* info;
+    unsigned            i;
 
     dwarf2_init_section(&eh_frame,                fmap, ".eh_frame",     NULL,             &eh_frame_sect);
     dwarf2_init_section(&section[section_debug],  fmap, ".debug_info",   ".zdebug_info",   &debug_sect);
@@ -3556,8 +3801,11 @@ BOOL dwarf2_parse(struct module* module, unsigned long load_offset,
     dwarf2_modfmt->module = module;
     dwarf2_modfmt->remove = dwarf2_module_remove;
     dwarf2_modfmt->loc_compute = dwarf2_location_compute;
-    dwarf2_modfmt->u.dwarf2_info = (struct dwarf2_module_info_s*)(dwarf2_modfmt + 1);
-    dwarf2_modfmt->u.dwarf2_info->word_size = 0; /* will be correctly set later on */
+    dwarf2_modfmt->load_units = dwarf2_load_units;
+    dwarf2_modfmt->u.dwarf2_info = info = (struct dwarf2_module_info_s*)(dwarf2_modfmt + 1);
+    info->word_size = 0; /* will be correctly set later on */
+    info->units = NULL;
+    info->num_units = info->num_pending = 0;
     dwarf2_modfmt->module->format_info[DFI_DWARF] = dwarf2_modfmt;
 
     /* As we'll need later some sections' content, we won't unmap these
@@ -3567,7 +3815,49 @@ BOOL dwarf2_parse(struct module* module, unsigned long load_offset,
     dwarf2_init_section(&dwarf2_modfmt->u.dwarf2_info->debug_frame, fmap, ".debug_frame", ".zdebug_frame", NULL);
     dwarf2_modfmt->u.dwarf2_info->eh_frame = eh_frame;
 
-    while (mod_ctx.data < mod_ctx.end_data)
+    /* Compilation units are only loaded once an address they cover is looked up,
+     * or when the whole debug information is needed.
+     * Mach-O symtab merging and automatic publics need all the symbols upfront.
+     */
+    lazy = fmap->modtype != DMT_MACHO && !(dbghelp_options & SYMOPT_AUTO_PUBLICS);
+    if (lazy)
+    {
+        dwarf2_traverse_context_t   count_ctx = mod_ctx;
+
+        while (count_ctx.data + 4 <= count_ctx.end_data)
+        {
+            count_ctx.data += dwarf2_parse_u4(&count_ctx);
+            info->num_units++;
+        }
+        if (info->num_units &&
+            !(info->units = HeapAlloc(GetProcessHeap(), 0, info->num_units * sizeof(*info->units))))
+            info->num_units = 0;
+    }
+
+    if (info->units)
+    {
+        for (i = 0; i < info->num_units && mod_ctx.data < mod_ctx.end_data; i++)
+        {
+            dwarf2_scan_compilation_unit(section, dwarf2_modfmt->module, &mod_ctx, &info->units[i]);
+            if (!info->units[i].loaded) info->num_pending++;
+        }
+        info->num_units = i;
+        if (info->num_pending)
+        {
+            memcpy(info->sections, section, sizeof(section));
+            info->thunks = thunks;
+            info->load_offset = load_offset;
+            keep_sections = TRUE;
+            TRACE("deferring %u compilation units\n", info->num_pending);
+        }
+        else
+        {
+            HeapFree(GetProcessHeap(), 0, info->units);
+            info->units = NULL;
+            info->num_units = 0;
+        }
+    }
+    else while (mod_ctx.data < mod_ctx.end_data)
     {
         dwarf2_parse_compilation_unit(section, dwarf2_modfmt->module, thunks, &mod_ctx, load_offset);
     }
@@ -3583,17 +3873,21 @@ BOOL dwarf2_parse(struct module* module, unsigned long load_offset,
     dwarf2_modfmt->u.dwarf2_info->word_size = fmap->addr_size / 8;
 
 leave:
-    dwarf2_fini_section(&section[section_debug]);
-    dwarf2_fini_section(&section[section_abbrev]);
-    dwarf2_fini_section(&section[section_string]);
-    dwarf2_fini_section(&section[section_line]);
-    dwarf2_fini_section(&section[section_ranges]);
-
-    image_unmap_section(&debug_sect);
-    image_unmap_section(&debug_abbrev_sect);
-    image_unmap_section(&debug_str_sect);
-    image_unmap_section(&debug_line_sect);
-    image_unmap_section(&debug_ranges_sect);
+    /* pending units still need the sections, they're released with the module */
+    if (!keep_sections)
+    {
+        dwarf2_fini_section(&section[section_debug]);
+        dwarf2_fini_section(&section[section_abbrev]);
+        dwarf2_fini_section(&section[section_string]);
+        dwarf2_fini_section(&section[section_line]);
+        dwarf2_fini_section(&section[section_ranges]);
+
+        image_unmap_section(&debug_sect);
+        image_unmap_section(&debug_abbrev_sect);
+        image_unmap_section(&debug_str_sect);
+        image_unmap_section(&debug_line_sect);
+        image_unmap_section(&debug_ranges_sect);
+    }
     if (!ret) image_unmap_section(&eh_frame_sect);
 
     return ret;
@@ -137,6 +137,8 @@ struct elf_module_info
     unsigned short	        elf_mark : 1,
                                 elf_loader : 1;
     struct image_file_map       file_map;
+    /* kept with the module as DWARF compilation units may be loaded later on */
+    struct elf_thunk_area       thunks[7];
 };
 
 /******************************************************************
@@ -866,6 +868,14 @@ static int elf_new_wine_thunks(struct module* module, const struct hash_table* h
             ULONG64     ref_addr;
             struct location loc;
 
+            /* wait for the compilation unit covering this address to be loaded */
+            if ((ELF32_ST_TYPE(ste->sym.st_info) == STT_FUNC ||
+                 ELF32_ST_TYPE(ste->sym.st_info) == STT_OBJECT) &&
+                dwarf2_defer_symbol(module, ste->compiland, ste->ht_elt.name, addr, ste->sym.st_size,
+                                    ELF32_ST_TYPE(ste->sym.st_info) == STT_OBJECT,
+                                    ELF32_ST_BIND(ste->sym.st_info) == STB_LOCAL))
+                continue;
+
             symt = symt_find_nearest(module, addr);
             if (symt && !symt_get_address(&symt->symt, &ref_addr))
                 ref_addr = addr;
@@ -1182,7 +1192,7 @@ static BOOL elf_load_debug_info_from_map(struct module* module,
                                          struct hash_table* ht_symtab)
 {
     BOOL                ret = FALSE, lret;
-    struct elf_thunk_area thunks[] = 
+    static const struct elf_thunk_area thunk_areas[] =
     {
         {"__wine_spec_import_thunks",           THUNK_ORDINAL_NOTYPE, 0, 0},    /* inter DLL calls */
         {"__wine_spec_delayed_import_loaders",  THUNK_ORDINAL_LOAD,   0, 0},    /* delayed inter DLL calls */
@@ -1192,7 +1202,9 @@ static BOOL elf_load_debug_info_from_map(struct module* module,
         {"__wine_spec_thunk_text_32",           -32,                  0, 0},    /* 32 => 16 thunks */
         {NULL,                                  0,                    0, 0}
     };
+    struct elf_thunk_area* thunks = module->format_info[DFI_ELF]->u.elf_info->thunks;
 
+    memcpy(thunks, thunk_areas, sizeof(thunk_areas));
     module->module.SymType = SymExport;
 
     /* create a hash table for the symtab */
@@ -1398,6 +1410,7 @@ static BOOL elf_load_file_from_fmap(struct process* pcs, const WCHAR* filename,
         modfmt->module      = elf_info->module;
         modfmt->remove      = elf_module_remove;
         modfmt->loc_compute = NULL;
+        modfmt->load_units  = NULL;
         modfmt->u.elf_info  = elf_module_info;
 
         elf_module_info->elf_addr = load_offset;
@@ -314,7 +314,7 @@ struct module* module_is_already_loaded(const struct process* pcs, const WCHAR*
  *           module_get_container
  *
  */
-static struct module* module_get_container(const struct process* pcs,
+struct module* module_get_container(const struct process* pcs,
                                     const struct module* inner)
 {
     struct module*      module;
@@ -351,7 +351,7 @@ struct module* module_get_containee(const struct process* pcs,
 }
 
 /******************************************************************
- *		module_get_debug
+ *		module_load_debug
  *
  * get the debug information from a module:
  * - if the module's type is deferred, then force loading of debug info (and return
@@ -360,7 +360,7 @@ struct module* module_get_containee(const struct process* pcs,
  *   container (and also force the ELF container's debug info loading if deferred)
  * - otherwise return the module itself if it has some debug info
  */
-BOOL module_get_debug(struct module_pair* pair)
+static BOOL module_load_debug(struct module_pair* pair)
 {
     IMAGEHLP_DEFERRED_SYMBOL_LOADW64    idslW64;
 
@@ -409,6 +409,46 @@ BOOL module_get_debug(struct module_pair* pair)
     return pair->effective->module.SymType != SymNone;
 }
 
+static void module_load_units(struct module* module, const DWORD_PTR* addr)
+{
+    unsigned i;
+
+    for (i = 0; i < DFI_LAST; i++)
+    {
+        if (module->format_info[i] && module->format_info[i]->load_units)
+            module->format_info[i]->load_units(module->format_info[i], addr);
+    }
+    module->module.NumSyms = module->ht_symbols.num_elts;
+}
+
+/******************************************************************
+ *		module_get_debug
+ *
+ * get all the debug information from a module (see module_load_debug)
+ */
+BOOL module_get_debug(struct module_pair* pair)
+{
+    if (!module_load_debug(pair)) return FALSE;
+    module_load_units(pair->effective, NULL);
+    symcache_save(pair->effective);
+    return TRUE;
+}
+
+/******************************************************************
+ *		module_get_debug_at
+ *
+ * same as module_get_debug, but only requires the debug information
+ * describing the given address
+ */
+BOOL module_get_debug_at(struct module_pair* pair, DWORD_PTR addr)
+{
+    if (!module_load_debug(pair)) return FALSE;
+    /* the symbol cache is only written from the complete information */
+    if (symcache_needs_save(pair->effective)) return module_get_debug(pair);
+    module_load_units(pair->effective, &addr);
+    return TRUE;
+}
+
 /***********************************************************************
  *	module_find_by_addr
  *
@@ -702,10 +742,12 @@ BOOL module_remove(struct process* pcs, struct module* module)
         if ((modfmt = module->format_info[i]) && modfmt->remove)
             modfmt->remove(pcs, module->format_info[i]);
     }
+    symcache_close(module);
     hash_table_destroy(&module->ht_symbols);
     hash_table_destroy(&module->ht_types);
     HeapFree(GetProcessHeap(), 0, module->sources);
     HeapFree(GetProcessHeap(), 0, module->addr_sorttab);
+    HeapFree(GetProcessHeap(), 0, module->sorttab_addr);
     pool_destroy(&module->pool);
     /* native dbghelp doesn't invoke registered callback(,CBA_SYMBOLS_UNLOADED,) here
      * so do we
@@ -1130,6 +1172,10 @@ void module_reset_debug_info(struct module* module)
     module->sorttab_size = 0;
     module->addr_sorttab = NULL;
     module->num_sorttab = module->num_symbols = 0;
+    HeapFree(GetProcessHeap(), 0, module->sorttab_addr);
+    module->sorttab_addr = NULL;
+    module->sorttab_addr_size = 0;
+    memset(module->nearest_cache, 0, sizeof(module->nearest_cache));
     hash_table_destroy(&module->ht_symbols);
     module->ht_symbols.num_buckets = 0;
     module->ht_symbols.buckets = NULL;
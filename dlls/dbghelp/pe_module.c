@@ -766,6 +766,7 @@ struct module* pe_load_native_module(struct process* pcs, const WCHAR* name,
             modfmt->module = module;
             modfmt->remove = pe_module_remove;
             modfmt->loc_compute = NULL;
+            modfmt->load_units = NULL;
 
             module->format_info[DFI_PE] = modfmt;
             if (dbghelp_options & SYMOPT_DEFERRED_LOADS)
@@ -835,6 +835,26 @@ static BOOL resort_symbols(struct module* module)
         }
     }
     module->num_sorttab = module->num_symbols;
+
+    /* keep a flat copy of the sorted addresses, so that searching doesn't
+     * need to look into every probed symbol */
+    if (module->sorttab_addr_size < module->num_sorttab)
+    {
+        DWORD64*    new;
+
+        if (module->sorttab_addr)
+            new = HeapReAlloc(GetProcessHeap(), 0, module->sorttab_addr,
+                              module->sorttab_size * sizeof(DWORD64));
+        else
+            new = HeapAlloc(GetProcessHeap(), 0, module->sorttab_size * sizeof(DWORD64));
+        if (!new) return FALSE;
+        module->sorttab_addr = new;
+        module->sorttab_addr_size = module->sorttab_size;
+    }
+    for (delta = 0; delta < module->num_sorttab; delta++)
+        symt_get_address(&module->addr_sorttab[delta]->symt, &module->sorttab_addr[delta]);
+    memset(module->nearest_cache, 0, sizeof(module->nearest_cache));
+
     return module->sortlist_valid = TRUE;
 }
 
@@ -881,51 +901,68 @@ static int symt_get_best_at(struct module* module, int idx_sorttab)
 struct symt_ht* symt_find_nearest(struct module* module, DWORD_PTR addr)
 {
     int         mid, high, low;
-    ULONG64     ref_addr, ref_size;
+    ULONG64     ref_size, last_end;
+    unsigned    i;
 
     if (!module->sortlist_valid || !module->addr_sorttab)
     {
         if (!resort_symbols(module)) return NULL;
     }
 
+    /* addresses strictly between two sorted symbols always give the same
+     * answer, so remember the last few of those ranges
+     */
+    for (i = 0; i < ARRAY_SIZE(module->nearest_cache); i++)
+    {
+        if (module->nearest_cache[i].symt &&
+            addr > module->nearest_cache[i].start && addr < module->nearest_cache[i].end)
+            return module->nearest_cache[i].symt;
+    }
+
     /*
      * Binary search to find closest symbol.
      */
     low = 0;
     high = module->num_sorttab;
 
-    symt_get_address(&module->addr_sorttab[0]->symt, &ref_addr);
-    if (addr <= ref_addr)
+    if (addr <= module->sorttab_addr[0])
     {
         low = symt_get_best_at(module, 0);
         return module->addr_sorttab[low];
     }
 
-    if (high)
-    {
-        symt_get_address(&module->addr_sorttab[high - 1]->symt, &ref_addr);
-        symt_get_length(module, &module->addr_sorttab[high - 1]->symt, &ref_size);
-        if (addr >= ref_addr + ref_size) return NULL;
-    }
-    
+    symt_get_length(module, &module->addr_sorttab[high - 1]->symt, &ref_size);
+    last_end = module->sorttab_addr[high - 1] + ref_size;
+    if (addr >= last_end) return NULL;
+
     while (high > low + 1)
     {
         mid = (high + low) / 2;
-        if (cmp_sorttab_addr(module, mid, addr) < 0)
+        if (module->sorttab_addr[mid] < addr)
             low = mid;
         else
             high = mid;
     }
     if (low != high && high != module->num_sorttab &&
-        cmp_sorttab_addr(module, high, addr) <= 0)
+        module->sorttab_addr[high] <= addr)
         low = high;
 
     /* If found symbol is a public symbol, check if there are any other entries that
      * might also have the same address, but would get better information
      */
-    low = symt_get_best_at(module, low);
+    mid = symt_get_best_at(module, low);
+
+    if (module->sorttab_addr[low] < addr)
+    {
+        i = module->nearest_cache_next;
+        module->nearest_cache[i].start = module->sorttab_addr[low];
+        module->nearest_cache[i].end = low + 1 < module->num_sorttab ?
+            module->sorttab_addr[low + 1] : last_end;
+        module->nearest_cache[i].symt = module->addr_sorttab[mid];
+        module->nearest_cache_next = (i + 1) % ARRAY_SIZE(module->nearest_cache);
+    }
 
-    return module->addr_sorttab[low];
+    return module->addr_sorttab[mid];
 }
 
 static BOOL symt_enum_locals_helper(struct module_pair* pair,
@@ -987,7 +1024,7 @@ static BOOL symt_enum_locals(struct process* pcs, const WCHAR* mask,
 
     pair.pcs = pcs;
     pair.requested = module_find_by_addr(pair.pcs, pc, DMT_UNKNOWN);
-    if (!module_get_debug(&pair)) return FALSE;
+    if (!module_get_debug_at(&pair, pc)) return FALSE;
     if ((sym = symt_find_nearest(pair.effective, pc)) == NULL) return FALSE;
 
     if (sym->symt.tag == SymTagFunction)
@@ -1247,8 +1284,11 @@ BOOL WINAPI SymFromAddr(HANDLE hProcess, DWORD64 Address,
     pair.pcs = process_find_by_handle(hProcess);
     if (!pair.pcs) return FALSE;
     pair.requested = module_find_by_addr(pair.pcs, Address, DMT_UNKNOWN);
-    if (!module_get_debug(&pair)) return FALSE;
-    if ((sym = symt_find_nearest(pair.effective, Address)) == NULL) return FALSE;
+    if (!(sym = symcache_find_symbol(&pair, Address)))
+    {
+        if (!module_get_debug_at(&pair, Address)) return FALSE;
+        if ((sym = symt_find_nearest(pair.effective, Address)) == NULL) return FALSE;
+    }
 
     symt_fill_sym_info(&pair, NULL, &sym->symt, Symbol);
     if (Displacement)
@@ -1606,7 +1646,7 @@ BOOL WINAPI SymGetLineFromAddr64(HANDLE hProcess, DWORD64 dwAddr,
     pair.pcs = process_find_by_handle(hProcess);
     if (!pair.pcs) return FALSE;
     pair.requested = module_find_by_addr(pair.pcs, dwAddr, DMT_UNKNOWN);
-    if (!module_get_debug(&pair)) return FALSE;
+    if (!module_get_debug_at(&pair, dwAddr)) return FALSE;
     if ((symt = symt_find_nearest(pair.effective, dwAddr)) == NULL) return FALSE;
 
     if (symt->symt.tag != SymTagFunction) return FALSE;
@@ -1649,7 +1689,7 @@ BOOL WINAPI SymGetLinePrev64(HANDLE hProcess, PIMAGEHLP_LINE64 Line)
     pair.pcs = process_find_by_handle(hProcess);
     if (!pair.pcs) return FALSE;
     pair.requested = module_find_by_addr(pair.pcs, Line->Address, DMT_UNKNOWN);
-    if (!module_get_debug(&pair)) return FALSE;
+    if (!module_get_debug_at(&pair, Line->Address)) return FALSE;
 
     if (Line->Key == 0) return FALSE;
     li = Line->Key;
@@ -1732,7 +1772,7 @@ BOOL WINAPI SymGetLineNext64(HANDLE hProcess, PIMAGEHLP_LINE64 Line)
     pair.pcs = process_find_by_handle(hProcess);
     if (!pair.pcs) return FALSE;
     pair.requested = module_find_by_addr(pair.pcs, Line->Address, DMT_UNKNOWN);
-    if (!module_get_debug(&pair)) return FALSE;
+    if (!module_get_debug_at(&pair, Line->Address)) return FALSE;
 
     if (symt_get_func_line_next(pair.effective, Line)) return TRUE;
     SetLastError(ERROR_NO_MORE_ITEMS); /* FIXME */
@@ -0,0 +1,359 @@
+/*
+ * Persistent index of module symbols
+ *
+ * This library is free software; you can redistribute it and/or
+ * modify it under the terms of the GNU Lesser General Public
+ * License as published by the Free Software Foundation; either
+ * version 2.1 of the License, or (at your option) any later version.
+ *
+ * This library is distributed in the hope that it will be useful,
+ * but WITHOUT ANY WARRANTY; without even the implied warranty of
+ * MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the GNU
+ * Lesser General Public License for more details.
+ *
+ * You should have received a copy of the GNU Lesser General Public
+ * License along with this library; if not, write to the Free Software
+ * Foundation, Inc., 51 Franklin St, Fifth Floor, Boston, MA 02110-1301, USA
+ *
+ * When the DBGHELP_SYMCACHE environment variable names a directory, the
+ * function and public symbols of a module are saved there once its debug
+ * information has been loaded. The file is keyed by the module's name,
+ * time stamp, checksum and size, and later processes use it to answer
+ * SymFromAddr for modules whose debug information is still deferred.
+ *
+ * Type indices only exist in memory, so symbols which have a type (most
+ * functions from the debug information) aren't served from the cache, and
+ * the lookup falls back to loading the debug information instead.
+ */
+
+#include <stdlib.h>
+#include <string.h>
+
+#include "dbghelp_private.h"
+#include "wine/debug.h"
+
+WINE_DEFAULT_DEBUG_CHANNEL(dbghelp);
+
+#define SYMCACHE_MAGIC   (('S') | ('Y' << 8) | ('M' << 16) | ('X' << 24))
+#define SYMCACHE_VERSION 2
+
+struct symcache_header
+{
+    DWORD       magic;
+    DWORD       version;
+    DWORD       num_entries;
+    DWORD       strings_size;
+};
+
+/* entries are sorted by address, followed by the names */
+struct symcache_entry
+{
+    DWORD       rva;
+    DWORD       size;
+    DWORD       name;   /* offset in the names */
+    WORD        tag;
+    WORD        flags;
+};
+
+#define SYMCACHE_TYPED  0x0001  /* has a type, must be looked up in the debug information */
+#define SYMCACHE_CODE   0x0002  /* public symbol is a function */
+
+static BOOL symcache_get_filename(const struct module* module, WCHAR* buffer, DWORD size)
+{
+    static const WCHAR fmtW[] = {'\\','%','s','-','%','0','8','x','%','0','8','x','%','0','8','x','.','s','y','m',0};
+    static const WCHAR symcacheW[] = {'D','B','G','H','E','L','P','_','S','Y','M','C','A','C','H','E',0};
+    WCHAR       name[64];
+    DWORD       len;
+    unsigned    i;
+
+    len = GetEnvironmentVariableW(symcacheW, buffer, size);
+    if (!len || len + ARRAY_SIZE(name) + 32 > size) return FALSE;
+
+    /* ELF module names end with <elf>, keep the file name portable */
+    lstrcpynW(name, module->module.ModuleName, ARRAY_SIZE(name));
+    for (i = 0; name[i]; i++)
+    {
+        if (!isalnumW(name[i]) && name[i] != '.' && name[i] != '_' && name[i] != '-')
+            name[i] = '_';
+    }
+    sprintfW(buffer + len, fmtW, name, module->module.TimeDateStamp,
+             module->module.CheckSum, module->module.ImageSize);
+    return TRUE;
+}
+
+static void symcache_open(struct module* module)
+{
+    const struct symcache_header* header;
+    WCHAR       filename[MAX_PATH];
+    HANDLE      file, map;
+    DWORD       size;
+
+    module->symcache_checked = TRUE;
+    if (!symcache_get_filename(module, filename, ARRAY_SIZE(filename))) return;
+
+    file = CreateFileW(filename, GENERIC_READ, FILE_SHARE_READ, NULL, OPEN_EXISTING, 0, NULL);
+    if (file == INVALID_HANDLE_VALUE) return;
+    size = GetFileSize(file, NULL);
+    map = CreateFileMappingW(file, NULL, PAGE_READONLY, 0, 0, NULL);
+    CloseHandle(file);
+    if (!map) return;
+    header = MapViewOfFile(map, FILE_MAP_READ, 0, 0, 0);
+    CloseHandle(map);
+    if (!header) return;
+
+    if (size < sizeof(*header) || header->magic != SYMCACHE_MAGIC ||
+        header->version != SYMCACHE_VERSION ||
+        header->num_entries > (size - sizeof(*header)) / sizeof(struct symcache_entry) ||
+        header->strings_size != size - sizeof(*header) - header->num_entries * sizeof(struct symcache_entry) ||
+        (header->strings_size && ((const char*)header)[size - 1]))
+    {
+        WARN("invalid symbol cache %s\n", debugstr_w(filename));
+        UnmapViewOfFile(header);
+        return;
+    }
+    if (!(module->symcache_syms = pool_alloc(&module->pool, header->num_entries * sizeof(struct symt_ht*))))
+    {
+        UnmapViewOfFile(header);
+        return;
+    }
+    memset(module->symcache_syms, 0, header->num_entries * sizeof(struct symt_ht*));
+    TRACE("using %u symbols from %s\n", header->num_entries, debugstr_w(filename));
+    module->symcache = header;
+}
+
+void symcache_close(struct module* module)
+{
+    if (module->symcache) UnmapViewOfFile(module->symcache);
+    module->symcache = NULL;
+    module->symcache_syms = NULL;
+}
+
+/* creates the symbol for a cache entry, without adding it to the module's
+ * symbol tables, so that it gets an index like any other symbol */
+static struct symt_ht* symcache_get_symbol(struct module* module, unsigned idx)
+{
+    const struct symcache_header* header = module->symcache;
+    const struct symcache_entry* entry = (const struct symcache_entry*)(header + 1) + idx;
+    const char* name = (const char*)((const struct symcache_entry*)(header + 1) + header->num_entries) + entry->name;
+    struct symt_function* func;
+    struct symt_public* pub;
+
+    if (module->symcache_syms[idx]) return module->symcache_syms[idx];
+    switch (entry->tag)
+    {
+    case SymTagFunction:
+        if (!(func = pool_alloc(&module->pool, sizeof(*func)))) return NULL;
+        func->symt.tag      = SymTagFunction;
+        func->hash_elt.name = pool_strdup(&module->pool, name);
+        func->hash_elt.next = NULL;
+        func->address       = module->module.BaseOfImage + entry->rva;
+        func->container     = NULL;
+        func->type          = NULL;
+        func->size          = entry->size;
+        vector_init(&func->vlines, sizeof(struct line_info), 64);
+        vector_init(&func->vchildren, sizeof(struct symt*), 8);
+        module->symcache_syms[idx] = (struct symt_ht*)func;
+        break;
+    case SymTagPublicSymbol:
+        if (!(pub = pool_alloc(&module->pool, sizeof(*pub)))) return NULL;
+        pub->symt.tag      = SymTagPublicSymbol;
+        pub->hash_elt.name = pool_strdup(&module->pool, name);
+        pub->hash_elt.next = NULL;
+        pub->container     = NULL;
+        pub->is_function   = (entry->flags & SYMCACHE_CODE) != 0;
+        pub->address       = module->module.BaseOfImage + entry->rva;
+        pub->size          = entry->size;
+        module->symcache_syms[idx] = (struct symt_ht*)pub;
+        break;
+    default:
+        return NULL;
+    }
+    return module->symcache_syms[idx];
+}
+
+/******************************************************************
+ *		symcache_find_symbol
+ *
+ * Looks up addr in the cached index of a module whose debug information
+ * hasn't been loaded yet. On success, pair->effective is set to the module
+ * holding the returned symbol.
+ */
+struct symt_ht* symcache_find_symbol(struct module_pair* pair, DWORD64 addr)
+{
+    const struct symcache_header* header;
+    const struct symcache_entry* entries;
+    struct module* module;
+    struct symt_ht* sym;
+    DWORD       rva;
+    int         low, high, mid;
+
+    if (!pair->requested) return NULL;
+    if (!(module = module_get_container(pair->pcs, pair->requested)))
+        module = pair->requested;
+    if (module->module.SymType != SymDeferred) return NULL;
+    if (!module->symcache_checked) symcache_open(module);
+    if (!(header = module->symcache) || !header->num_entries) return NULL;
+
+    entries = (const struct symcache_entry*)(header + 1);
+    if (addr < module->module.BaseOfImage || addr - module->module.BaseOfImage >= module->module.ImageSize)
+        return NULL;
+    rva = addr - module->module.BaseOfImage;
+
+    /* find the last entry at or before rva */
+    if (rva < entries[0].rva) return NULL;
+    low = 0;
+    high = header->num_entries;
+    while (high > low + 1)
+    {
+        mid = (low + high) / 2;
+        if (entries[mid].rva <= rva) low = mid;
+        else high = mid;
+    }
+    /* the best symbol at a given address comes first */
+    while (low > 0 && entries[low - 1].rva == entries[low].rva) low--;
+    /* the index has no data symbols, so only answer for addresses within the
+     * symbol and let the debug information handle anything else */
+    if (rva != entries[low].rva && rva - entries[low].rva >= entries[low].size)
+        return NULL;
+    if ((entries[low].flags & SYMCACHE_TYPED) || entries[low].name >= header->strings_size)
+        return NULL;
+
+    if (!(sym = symcache_get_symbol(module, low))) return NULL;
+    pair->effective = module;
+    return sym;
+}
+
+static int symcache_cmp_entry(const void* p1, const void* p2)
+{
+    const struct symcache_entry* e1 = p1;
+    const struct symcache_entry* e2 = p2;
+
+    if (e1->rva != e2->rva) return e1->rva < e2->rva ? -1 : 1;
+    /* prefer functions to public symbols */
+    if (e1->tag != e2->tag) return e1->tag == SymTagPublicSymbol ? 1 : -1;
+    return 0;
+}
+
+static BOOL symcache_get_entry(const struct module* module, const struct symt_ht* sym, DWORD* rva)
+{
+    ULONG64     addr;
+
+    if (sym->symt.tag != SymTagFunction && sym->symt.tag != SymTagPublicSymbol) return FALSE;
+    if (!symt_get_address(&sym->symt, &addr) || addr < module->module.BaseOfImage ||
+        addr - module->module.BaseOfImage >= module->module.ImageSize) return FALSE;
+    *rva = addr - module->module.BaseOfImage;
+    return TRUE;
+}
+
+static WORD symcache_get_flags(const struct symt_ht* sym)
+{
+    switch (sym->symt.tag)
+    {
+    case SymTagFunction:
+        return ((const struct symt_function*)sym)->type ? SYMCACHE_TYPED : 0;
+    case SymTagPublicSymbol:
+        return ((const struct symt_public*)sym)->is_function ? SYMCACHE_CODE : 0;
+    default:
+        return 0;
+    }
+}
+
+/******************************************************************
+ *		symcache_needs_save
+ *
+ * Checks whether a cache directory is set and doesn't have a valid index
+ * of the module yet (either missing or written by another version).
+ */
+BOOL symcache_needs_save(struct module* module)
+{
+    WCHAR       filename[MAX_PATH];
+
+    if (module->symcache_saved) return FALSE;
+    if (!module->symcache_checked) symcache_open(module);
+    if (module->symcache || !symcache_get_filename(module, filename, ARRAY_SIZE(filename)))
+    {
+        module->symcache_saved = TRUE;
+        return FALSE;
+    }
+    return TRUE;
+}
+
+/******************************************************************
+ *		symcache_save
+ *
+ * Writes the index of a module whose debug information is fully loaded.
+ */
+void symcache_save(struct module* module)
+{
+    struct symcache_header header;
+    struct symcache_entry* entries;
+    struct hash_table_iter hti;
+    struct symt_ht* sym;
+    WCHAR       filename[MAX_PATH];
+    HANDLE      file;
+    ULONG64     size;
+    DWORD       rva, count = 0, strings_size = 0, len, written;
+    char*       strings;
+    BOOL        ret;
+
+    if (!symcache_needs_save(module)) return;
+    module->symcache_saved = TRUE;
+    symcache_get_filename(module, filename, ARRAY_SIZE(filename));
+
+    hash_table_iter_init(&module->ht_symbols, &hti, NULL);
+    while ((sym = hash_table_iter_up(&hti)))
+    {
+        if (!symcache_get_entry(module, sym, &rva)) continue;
+        strings_size += strlen(symt_get_name(&sym->symt)) + 1;
+        count++;
+    }
+
+    entries = HeapAlloc(GetProcessHeap(), 0, count * sizeof(*entries) + strings_size);
+    if (!entries) return;
+    strings = (char*)(entries + count);
+
+    count = strings_size = 0;
+    hash_table_iter_init(&module->ht_symbols, &hti, NULL);
+    while ((sym = hash_table_iter_up(&hti)))
+    {
+        if (!symcache_get_entry(module, sym, &rva)) continue;
+        if (!symt_get_info(module, &sym->symt, TI_GET_LENGTH, &size)) size = 0;
+        len = strlen(symt_get_name(&sym->symt)) + 1;
+        memcpy(strings + strings_size, symt_get_name(&sym->symt), len);
+        entries[count].rva = rva;
+        entries[count].size = size;
+        entries[count].name = strings_size;
+        entries[count].tag = sym->symt.tag;
+        entries[count].flags = symcache_get_flags(sym);
+        strings_size += len;
+        count++;
+    }
+    qsort(entries, count, sizeof(*entries), symcache_cmp_entry);
+
+    header.magic = SYMCACHE_MAGIC;
+    header.version = SYMCACHE_VERSION;
+    header.num_entries = count;
+    header.strings_size = strings_size;
+
+    /* write to a temporary file first, so that readers never see a partial index */
+    len = strlenW(filename);
+    filename[len] = '~';
+    filename[len + 1] = 0;
+    file = CreateFileW(filename, GENERIC_WRITE, 0, NULL, CREATE_ALWAYS, 0, NULL);
+    if (file != INVALID_HANDLE_VALUE)
+    {
+        ret = WriteFile(file, &header, sizeof(header), &written, NULL) &&
+              WriteFile(file, entries, count * sizeof(*entries) + strings_size, &written, NULL);
+        CloseHandle(file);
+        if (ret)
+        {
+            WCHAR final[MAX_PATH];
+
+            lstrcpynW(final, filename, len + 1);
+            ret = MoveFileExW(filename, final, MOVEFILE_REPLACE_EXISTING);
+        }
+        if (!ret) DeleteFileW(filename);
+        else TRACE("saved %u symbols for %s\n", count, debugstr_w(module->module.ModuleName));
+    }
+    HeapFree(GetProcessHeap(), 0, entries);
+}
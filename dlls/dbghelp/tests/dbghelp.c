@@ -16,6 +16,8 @@
  * Foundation, Inc., 51 Franklin St, Fifth Floor, Boston, MA 02110-1301, USA
  */
 
+#include <stdio.h>
+
 #include "windef.h"
 #include "verrsrc.h"
 #include "dbghelp.h"
@@ -132,6 +134,199 @@ static void test_stack_walk(void)
 
 #endif /* __i386__ || __x86_64__ */
 
+struct symcache_result
+{
+    BOOL    sym_ret;
+    char    name[200];
+    DWORD64 address;
+    DWORD64 disp;
+    ULONG   size;
+    ULONG   flags;
+    ULONG   tag;
+    BOOL    has_type;
+    BOOL    line_ret;
+    DWORD   line;
+    char    file[MAX_PATH];
+};
+
+static void symcache_lookup(DWORD64 addr, struct symcache_result *res)
+{
+    char si_buf[sizeof(SYMBOL_INFO) + 200];
+    SYMBOL_INFO *si = (SYMBOL_INFO *)si_buf;
+    IMAGEHLP_LINE64 line;
+    DWORD disp;
+
+    memset(res, 0, sizeof(*res));
+    si->SizeOfStruct = sizeof(SYMBOL_INFO);
+    si->MaxNameLen = 200;
+    res->sym_ret = SymFromAddr(GetCurrentProcess(), addr, &res->disp, si);
+    if (res->sym_ret)
+    {
+        ok(si->Index != 0, "got zero index for %s\n", si->Name);
+        strcpy(res->name, si->Name);
+        res->address = si->Address;
+        res->size = si->Size;
+        res->flags = si->Flags;
+        res->tag = si->Tag;
+        res->has_type = si->TypeIndex != 0;
+    }
+
+    line.SizeOfStruct = sizeof(line);
+    res->line_ret = SymGetLineFromAddr64(GetCurrentProcess(), addr, &disp, &line);
+    if (res->line_ret)
+    {
+        res->line = line.LineNumber;
+        lstrcpynA(res->file, line.FileName, sizeof(res->file));
+    }
+}
+
+static void symcache_session(const DWORD64 *addrs, unsigned count, struct symcache_result *res)
+{
+    unsigned i;
+    BOOL ret;
+
+    ret = SymInitialize(GetCurrentProcess(), NULL, TRUE);
+    ok(ret, "got error %u\n", GetLastError());
+    for (i = 0; i < count; i++)
+        symcache_lookup(addrs[i], &res[i]);
+    ret = SymCleanup(GetCurrentProcess());
+    ok(ret, "got error %u\n", GetLastError());
+}
+
+static void symcache_compare(const struct symcache_result *expect, const struct symcache_result *got,
+                             unsigned count, const char *when)
+{
+    unsigned i;
+
+    for (i = 0; i < count; i++)
+    {
+        ok(got[i].sym_ret == expect[i].sym_ret, "%s %u: got %d\n", when, i, got[i].sym_ret);
+        if (got[i].sym_ret && expect[i].sym_ret)
+        {
+            ok(!strcmp(got[i].name, expect[i].name), "%s %u: got name %s, expected %s\n",
+               when, i, got[i].name, expect[i].name);
+            ok(got[i].address == expect[i].address, "%s %u: got address %s\n",
+               when, i, wine_dbgstr_longlong(got[i].address));
+            ok(got[i].disp == expect[i].disp, "%s %u: got displacement %s\n",
+               when, i, wine_dbgstr_longlong(got[i].disp));
+            ok(got[i].size == expect[i].size, "%s %u: got size %u, expected %u\n",
+               when, i, got[i].size, expect[i].size);
+            ok(got[i].flags == expect[i].flags, "%s %u: got flags %#x, expected %#x\n",
+               when, i, got[i].flags, expect[i].flags);
+            ok(got[i].tag == expect[i].tag, "%s %u: got tag %u, expected %u\n",
+               when, i, got[i].tag, expect[i].tag);
+            ok(got[i].has_type == expect[i].has_type, "%s %u: got type %d\n",
+               when, i, got[i].has_type);
+        }
+        ok(got[i].line_ret == expect[i].line_ret, "%s %u: got %d\n", when, i, got[i].line_ret);
+        if (got[i].line_ret && expect[i].line_ret)
+        {
+            ok(got[i].line == expect[i].line, "%s %u: got line %u, expected %u\n",
+               when, i, got[i].line, expect[i].line);
+            ok(!strcmp(got[i].file, expect[i].file), "%s %u: got file %s, expected %s\n",
+               when, i, got[i].file, expect[i].file);
+        }
+    }
+}
+
+static unsigned symcache_count_files(const char *dir, BOOL corrupt)
+{
+    char path[MAX_PATH];
+    WIN32_FIND_DATAA data;
+    HANDLE find, file;
+    unsigned count = 0;
+    DWORD written;
+
+    sprintf(path, "%s\\*.sym", dir);
+    find = FindFirstFileA(path, &data);
+    if (find == INVALID_HANDLE_VALUE) return 0;
+    do
+    {
+        count++;
+        if (!corrupt) continue;
+        /* looks like an index written by another version */
+        sprintf(path, "%s\\%s", dir, data.cFileName);
+        file = CreateFileA(path, GENERIC_WRITE, 0, NULL, TRUNCATE_EXISTING, 0, NULL);
+        ok(file != INVALID_HANDLE_VALUE, "failed to open %s, error %u\n", path, GetLastError());
+        WriteFile(file, "SYMX\xff\xff\xff\xff", 8, &written, NULL);
+        CloseHandle(file);
+    } while (FindNextFileA(find, &data));
+    FindClose(find);
+    return count;
+}
+
+static void symcache_delete_files(const char *dir)
+{
+    char path[MAX_PATH];
+    WIN32_FIND_DATAA data;
+    HANDLE find;
+
+    sprintf(path, "%s\\*", dir);
+    find = FindFirstFileA(path, &data);
+    if (find != INVALID_HANDLE_VALUE)
+    {
+        do
+        {
+            if (data.dwFileAttributes & FILE_ATTRIBUTE_DIRECTORY) continue;
+            sprintf(path, "%s\\%s", dir, data.cFileName);
+            DeleteFileA(path);
+        } while (FindNextFileA(find, &data));
+        FindClose(find);
+    }
+    RemoveDirectoryA(dir);
+}
+
+static void test_symcache(void)
+{
+    struct symcache_result expect[3], got[3];
+    char dir[MAX_PATH];
+    DWORD64 addrs[3];
+    unsigned count;
+    DWORD options;
+
+    GetTempPathA(sizeof(dir), dir);
+    sprintf(dir + strlen(dir), "dbghelp-symcache-%x", GetCurrentProcessId());
+    if (!CreateDirectoryA(dir, NULL))
+    {
+        skip("failed to create %s, error %u\n", dir, GetLastError());
+        return;
+    }
+
+    addrs[0] = (DWORD_PTR)test_symcache + 4;
+    addrs[1] = (DWORD_PTR)symcache_lookup;
+    addrs[2] = (DWORD_PTR)GetProcAddress(GetModuleHandleA("kernel32.dll"), "GetTickCount");
+
+    options = SymGetOptions();
+    SymSetOptions(options | SYMOPT_DEFERRED_LOADS);
+
+    /* without a cache */
+    symcache_session(addrs, ARRAY_SIZE(addrs), expect);
+    ok(expect[0].sym_ret, "SymFromAddr failed\n");
+
+    SetEnvironmentVariableA("DBGHELP_SYMCACHE", dir);
+
+    /* writes the cache */
+    symcache_session(addrs, ARRAY_SIZE(addrs), got);
+    symcache_compare(expect, got, ARRAY_SIZE(addrs), "write");
+    count = symcache_count_files(dir, FALSE);
+    ok(count > 0 || broken(!count) /* native doesn't have a cache */, "no cache file written\n");
+
+    /* reads the cache */
+    symcache_session(addrs, ARRAY_SIZE(addrs), got);
+    symcache_compare(expect, got, ARRAY_SIZE(addrs), "read");
+
+    /* rebuilds stale files */
+    ok(symcache_count_files(dir, TRUE) == count, "cache files changed\n");
+    symcache_session(addrs, ARRAY_SIZE(addrs), got);
+    symcache_compare(expect, got, ARRAY_SIZE(addrs), "stale");
+    symcache_session(addrs, ARRAY_SIZE(addrs), got);
+    symcache_compare(expect, got, ARRAY_SIZE(addrs), "rebuilt");
+
+    SetEnvironmentVariableA("DBGHELP_SYMCACHE", NULL);
+    SymSetOptions(options);
+    symcache_delete_files(dir);
+}
+
 START_TEST(dbghelp)
 {
     BOOL ret = SymInitialize(GetCurrentProcess(), NULL, TRUE);
@@ -141,4 +336,6 @@ START_TEST(dbghelp)
 
     ret = SymCleanup(GetCurrentProcess());
     ok(ret, "got error %u\n", GetLastError());
+
+    test_symcache();
 }
@@ -1140,6 +1140,7 @@ void secondarybuffer_destroy(IDirectSoundBufferImpl *This)
 
     HeapFree(GetProcessHeap(), 0, This->notifies);
     HeapFree(GetProcessHeap(), 0, This->pwfx);
+    HeapFree(GetProcessHeap(), 0, This->fir_table);
 
     if (This->filters) {
         int i;
@@ -1196,6 +1197,7 @@ HRESULT IDirectSoundBufferImpl_Duplicate(
     dsb->sec_mixpos = 0;
     dsb->notifies = NULL;
     dsb->nrofnotifies = 0;
+    dsb->fir_table = NULL;
     dsb->device = device;
     DSOUND_RecalcFormat(dsb);
 
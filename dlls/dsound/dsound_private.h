@@ -152,6 +152,10 @@ struct IDirectSoundBufferImpl
     float                       firgain;
     LONG64                      freqAdjustNum,freqAdjustDen;
     LONG64                      freqAccNum;
+    /* FIR coefficients of every phase of the current ratio, see update_fir_table */
+    float                      *fir_table;
+    UINT                        fir_table_taps;
+    LONG64                      fir_table_num, fir_table_den, fir_table_offset;
     /* used for mixing */
     DWORD                       sec_mixpos;
 
@@ -290,10 +290,121 @@ static UINT cp_fields_noresample(IDirectSoundBufferImpl *dsb, UINT count)
     return count;
 }
 
+/* Largest table of precomputed FIR coefficients kept per buffer */
+#define MAX_FIR_TABLE_SIZE (256 * 1024)
+
+static LONG64 gcd(LONG64 a, LONG64 b)
+{
+    while (b) {
+        LONG64 t = a % b;
+        a = b;
+        b = t;
+    }
+    return a;
+}
+
+/**
+ * Interpolate the FIR coefficients for an output sample lying
+ * phase / freqAdjustDen of the way past an input sample.
+ * Returns the number of coefficients written.
+ */
+static UINT get_fir_coefs(const IDirectSoundBufferImpl *dsb, LONG64 phase, float *coefs)
+{
+    UINT dsbfirstep = dsb->firstep;
+    UINT int_fir_steps = phase * dsbfirstep / dsb->freqAdjustDen;
+    float rem = 1.0f - (float)(phase * dsbfirstep % dsb->freqAdjustDen) / dsb->freqAdjustDen;
+    UINT idx = dsbfirstep - int_fir_steps - 1;
+    UINT fir_used = 0;
+
+    while (idx < fir_len - 1) {
+        coefs[fir_used++] = fir[idx] * (1.0 - rem) + fir[idx + 1] * rem;
+        idx += dsbfirstep;
+    }
+    return fir_used;
+}
+
+/**
+ * With a fixed ratio, the output samples only ever fall on
+ * freqAdjustDen / gcd(freqAdjustNum, freqAdjustDen) distinct phases, all
+ * congruent to the starting one. Precompute their coefficients once so
+ * that mixing only has to do the dot products.
+ *
+ * Returns FALSE if the table would be too large.
+ */
+static BOOL update_fir_table(IDirectSoundBufferImpl *dsb, LONG64 freqAcc_start, UINT taps)
+{
+    LONG64 step = gcd(dsb->freqAdjustNum, dsb->freqAdjustDen);
+    LONG64 phases = dsb->freqAdjustDen / step;
+    LONG64 offset = freqAcc_start % step;
+    float *table;
+    UINT *used;
+    UINT i;
+
+    if (dsb->fir_table && dsb->fir_table_num == dsb->freqAdjustNum &&
+        dsb->fir_table_den == dsb->freqAdjustDen && dsb->fir_table_offset == offset)
+        return TRUE;
+
+    if (phases * (taps + 1) * sizeof(float) > MAX_FIR_TABLE_SIZE)
+        return FALSE;
+
+    if (dsb->fir_table)
+        table = HeapReAlloc(GetProcessHeap(), 0, dsb->fir_table, phases * (taps + 1) * sizeof(float));
+    else
+        table = HeapAlloc(GetProcessHeap(), 0, phases * (taps + 1) * sizeof(float));
+    if (!table)
+        return FALSE;
+    dsb->fir_table = table;
+
+    used = (UINT *)(table + phases * taps);
+    for (i = 0; i < phases; i++)
+        used[i] = get_fir_coefs(dsb, offset + i * step, table + i * taps);
+
+    dsb->fir_table_taps = taps;
+    dsb->fir_table_num = dsb->freqAdjustNum;
+    dsb->fir_table_den = dsb->freqAdjustDen;
+    dsb->fir_table_offset = offset;
+    return TRUE;
+}
+
+/* Split in four sums so that the compiler can vectorize it without -ffast-math */
+static inline float fir_dot_product(const float *coefs, const float *input, UINT count)
+{
+    float sum0 = 0.0f, sum1 = 0.0f, sum2 = 0.0f, sum3 = 0.0f;
+    UINT j;
+
+    for (j = 0; j + 4 <= count; j += 4) {
+        sum0 += coefs[j] * input[j];
+        sum1 += coefs[j + 1] * input[j + 1];
+        sum2 += coefs[j + 2] * input[j + 2];
+        sum3 += coefs[j + 3] * input[j + 3];
+    }
+    for (; j < count; j++)
+        sum0 += coefs[j] * input[j];
+    return (sum0 + sum1) + (sum2 + sum3);
+}
+
+static void get_channel_samples(const IDirectSoundBufferImpl *dsb, DWORD channel, float *out, UINT count)
+{
+    UINT istride = dsb->pwfx->nBlockAlign;
+    DWORD pos = dsb->sec_mixpos;
+    UINT i;
+
+    for (i = 0; i < count; i++) {
+        if (pos >= dsb->buflen) {
+            if (!(dsb->playflags & DSBPLAY_LOOPING)) {
+                memset(out + i, 0, (count - i) * sizeof(float));
+                return;
+            }
+            pos %= dsb->buflen;
+        }
+        out[i] = dsb->get(dsb, pos, channel);
+        pos += istride;
+    }
+}
+
 static UINT cp_fields_resample(IDirectSoundBufferImpl *dsb, UINT count, LONG64 *freqAccNum)
 {
     UINT i, channel;
-    UINT istride = dsb->pwfx->nBlockAlign;
     UINT ostride = dsb->device->pwfx->nChannels * sizeof(float);
 
     LONG64 freqAcc_start = *freqAccNum;
@@ -304,7 +415,10 @@ static UINT cp_fields_resample(IDirectSoundBufferImpl *dsb, UINT count, LONG64 *
 
     UINT fir_cachesize = (fir_len + dsbfirstep - 2) / dsbfirstep;
     UINT required_input = max_ipos + fir_cachesize;
-    float *intermediate, *fir_copy, *itmp;
+    float *intermediate, *fir_copy, *coefs;
+    const UINT *fir_table_used = NULL;
+    LONG64 fir_table_step = 0;
+    BOOL use_table;
 
     DWORD len = required_input * channels;
     len += fir_cachesize;
@@ -326,35 +440,35 @@ static UINT cp_fields_resample(IDirectSoundBufferImpl *dsb, UINT count, LONG64 *
      * if you want -msse3 to have any effect.
      * This is good for CPU cache effects, too.
      */
-    itmp = intermediate;
     for (channel = 0; channel < channels; channel++)
-        for (i = 0; i < required_input; i++)
-            *(itmp++) = get_current_sample(dsb,
-                    dsb->sec_mixpos + i * istride, channel);
+        get_channel_samples(dsb, channel, intermediate + channel * required_input, required_input);
 
-    for(i = 0; i < count; ++i) {
-        UINT int_fir_steps = (freqAcc_start + i * dsb->freqAdjustNum) * dsbfirstep / dsb->freqAdjustDen;
-        float total_fir_steps = (freqAcc_start + i * dsb->freqAdjustNum) * dsbfirstep / (float)dsb->freqAdjustDen;
-        UINT ipos = int_fir_steps / dsbfirstep;
-
-        UINT idx = (ipos + 1) * dsbfirstep - int_fir_steps - 1;
-        float rem = int_fir_steps + 1.0 - total_fir_steps;
+    use_table = update_fir_table(dsb, freqAcc_start, fir_cachesize);
+    if (use_table) {
+        fir_table_step = gcd(dsb->freqAdjustNum, dsb->freqAdjustDen);
+        fir_table_used = (const UINT *)(dsb->fir_table + dsb->freqAdjustDen / fir_table_step * fir_cachesize);
+    }
 
-        int fir_used = 0;
-        while (idx < fir_len - 1) {
-            fir_copy[fir_used++] = fir[idx] * (1.0 - rem) + fir[idx + 1] * rem;
-            idx += dsb->firstep;
+    for(i = 0; i < count; ++i) {
+        LONG64 freqAcc = freqAcc_start + i * dsb->freqAdjustNum;
+        UINT ipos = freqAcc / dsb->freqAdjustDen;
+        LONG64 phase = freqAcc % dsb->freqAdjustDen;
+        UINT fir_used;
+
+        if (use_table) {
+            UINT k = phase / fir_table_step;
+            coefs = dsb->fir_table + k * fir_cachesize;
+            fir_used = fir_table_used[k];
+        } else {
+            coefs = fir_copy;
+            fir_used = get_fir_coefs(dsb, phase, fir_copy);
         }
 
         assert(fir_used <= fir_cachesize);
         assert(ipos + fir_used <= required_input);
 
         for (channel = 0; channel < dsb->mix_channels; channel++) {
-            int j;
-            float sum = 0.0;
-            float* cache = &intermediate[channel * required_input + ipos];
-            for (j = 0; j < fir_used; j++)
-                sum += fir_copy[j] * cache[j];
+            float sum = fir_dot_product(coefs, &intermediate[channel * required_input + ipos], fir_used);
             dsb->put(dsb, i * ostride, channel, sum * dsb->firgain);
         }
     }
@@ -446,10 +560,16 @@ static void DSOUND_MixToTemporary(IDirectSoundBufferImpl *dsb, DWORD frames)
 	}
 }
 
-static void DSOUND_MixerVol(const IDirectSoundBufferImpl *dsb, INT frames)
+/**
+ * Apply the buffer volume while adding the temporary buffer to the mix.
+ * Returns FALSE if there is no volume to apply and the caller should do
+ * a plain mix.
+ */
+static BOOL DSOUND_MixerVol(const IDirectSoundBufferImpl *dsb, float *mix_buffer, INT frames)
 {
 	INT	i;
 	float vols[DS_MAX_CHANNELS];
+	const float *src = dsb->device->tmp_buffer;
 	UINT channels = dsb->device->pwfx->nChannels, chan;
 
 	TRACE("(%p,%d)\n",dsb,frames);
@@ -459,22 +579,36 @@ static void DSOUND_MixerVol(const IDirectSoundBufferImpl *dsb, INT frames)
 	if ((!(dsb->dsbd.dwFlags & DSBCAPS_CTRLPAN) || (dsb->volpan.lPan == 0)) &&
 	    (!(dsb->dsbd.dwFlags & DSBCAPS_CTRLVOLUME) || (dsb->volpan.lVolume == 0)) &&
 	     !(dsb->dsbd.dwFlags & DSBCAPS_CTRL3D))
-		return; /* Nothing to do */
+		return FALSE; /* Nothing to do */
 
 	if (channels > DS_MAX_CHANNELS)
 	{
 		FIXME("There is no support for %u channels\n", channels);
-		return;
+		return FALSE;
 	}
 
 	for (i = 0; i < channels; ++i)
 		vols[i] = dsb->volpan.dwTotalAmpFactor[i] / ((float)0xFFFF);
 
+	if (channels == 2)
+	{
+		/* give the compiler a fixed stride to vectorize the common case */
+		float left = vols[0], right = vols[1];
+
+		for (i = 0; i < frames; ++i)
+		{
+			mix_buffer[2 * i] += src[2 * i] * left;
+			mix_buffer[2 * i + 1] += src[2 * i + 1] * right;
+		}
+		return TRUE;
+	}
+
 	for(i = 0; i < frames; ++i){
 		for(chan = 0; chan < channels; ++chan){
-			dsb->device->tmp_buffer[i * channels + chan] *= vols[chan];
+			mix_buffer[i * channels + chan] += src[i * channels + chan] * vols[chan];
 		}
 	}
+	return TRUE;
 }
 
 /**
@@ -502,10 +636,9 @@ static DWORD DSOUND_MixInBuffer(IDirectSoundBufferImpl *dsb, float *mix_buffer,
 	DSOUND_MixToTemporary(dsb, frames);
 	ibuf = dsb->device->tmp_buffer;
 
-	/* Apply volume if needed */
-	DSOUND_MixerVol(dsb, frames);
-
-	mixieee32(ibuf, mix_buffer, frames * dsb->device->pwfx->nChannels);
+	/* Apply volume if needed, in the same pass as the mixing */
+	if (!DSOUND_MixerVol(dsb, mix_buffer, frames))
+		mixieee32(ibuf, mix_buffer, frames * dsb->device->pwfx->nChannels);
 
 	/* check for notification positions */
 	if (dsb->dsbd.dwFlags & DSBCAPS_CTRLPOSITIONNOTIFY &&
@@ -652,7 +785,7 @@ static void DSOUND_WaveQueue(DirectSoundDevice *device, LPBYTE pos, DWORD bytes)
  *
  * secondary->buffer (secondary format)
  *   =[Resample]=> device->tmp_buffer (float format)
- *   =[Volume]=> device->tmp_buffer (float format)
+ *   =[Volume, Mix]=> device->buffer (float format)
  *   =[Reformat]=> device->buffer (device format, skipped on float)
  */
 static void DSOUND_PerformMix(DirectSoundDevice *device)
@@ -322,6 +322,68 @@ static HRESULT ensure_prop_name(jsdisp_t *This, const WCHAR *name, DWORD create_
     return hres;
 }
 
+/*
+ * Index properties keep a regular entry in the property table, but the DISPIDs
+ * of the dense part of the index space are cached so that index accesses don't
+ * need to format and hash the name. Entries are never removed from the table,
+ * so a cached DISPID stays valid for the lifetime of the object.
+ */
+static dispex_prop_t *get_cached_idx_prop(jsdisp_t *This, DWORD idx)
+{
+    if(idx < This->idx_props_size && This->idx_props[idx])
+        return This->props + This->idx_props[idx];
+    return NULL;
+}
+
+static void cache_idx_prop(jsdisp_t *This, DWORD idx, dispex_prop_t *prop)
+{
+    if(idx >= This->idx_props_size) {
+        DWORD size = max(max(idx+1, This->idx_props_size*2), 16);
+        DISPID *new_props;
+
+        /* don't bother for sparse indexes */
+        if(idx > 2*This->prop_cnt + 16)
+            return;
+
+        new_props = heap_realloc(This->idx_props, size*sizeof(*new_props));
+        if(!new_props)
+            return;
+        memset(new_props+This->idx_props_size, 0, (size-This->idx_props_size)*sizeof(*new_props));
+        This->idx_props = new_props;
+        This->idx_props_size = size;
+    }
+
+    This->idx_props[idx] = prop_to_id(This, prop);
+}
+
+static HRESULT find_prop_idx(jsdisp_t *This, DWORD idx, BOOL ensure, dispex_prop_t **ret)
+{
+    dispex_prop_t *prop;
+    WCHAR name[12];
+    HRESULT hres;
+
+    static const WCHAR formatW[] = {'%','u',0};
+
+    prop = get_cached_idx_prop(This, idx);
+    if(prop && prop->type != PROP_DELETED) {
+        *ret = prop;
+        return S_OK;
+    }
+
+    sprintfW(name, formatW, idx);
+    if(ensure)
+        hres = ensure_prop_name(This, name, PROPF_ENUMERABLE | PROPF_CONFIGURABLE | PROPF_WRITABLE, &prop);
+    else
+        hres = find_prop_name_prot(This, string_hash(name), name, &prop);
+    if(FAILED(hres))
+        return hres;
+
+    if(prop)
+        cache_idx_prop(This, idx, prop);
+    *ret = prop;
+    return S_OK;
+}
+
 static IDispatch *get_this(DISPPARAMS *dp)
 {
     DWORD i;
@@ -939,11 +1001,16 @@ jsdisp_t *to_jsdisp(IDispatch *disp)
 
 HRESULT init_dispex(jsdisp_t *dispex, script_ctx_t *ctx, const builtin_info_t *builtin_info, jsdisp_t *prototype)
 {
+    static LONG serial;
+
     TRACE("%p (%p)\n", dispex, prototype);
 
     dispex->IDispatchEx_iface.lpVtbl = &DispatchExVtbl;
     dispex->ref = 1;
+    while(!(dispex->serial = InterlockedIncrement(&serial)));
     dispex->builtin_info = builtin_info;
+    dispex->idx_props_size = 0;
+    dispex->idx_props = NULL;
 
     dispex->props = heap_alloc_zero(sizeof(dispex_prop_t)*(dispex->buf_size=4));
     if(!dispex->props)
@@ -1017,6 +1084,7 @@ void jsdisp_free(jsdisp_t *obj)
         heap_free(prop->name);
     }
     heap_free(obj->props);
+    heap_free(obj->idx_props);
     script_release(obj->ctx);
     if(obj->prototype)
         jsdisp_release(obj->prototype);
@@ -1107,6 +1175,47 @@ HRESULT jsdisp_get_id(jsdisp_t *jsdisp, const WCHAR *name, DWORD flags, DISPID *
     return DISP_E_UNKNOWNNAME;
 }
 
+/*
+ * Property table entries are never removed and names are unique, so as long as
+ * the cached entry is not deleted, it's the one a name lookup would find.
+ */
+HRESULT jsdisp_get_id_cached(jsdisp_t *jsdisp, const WCHAR *name, DWORD flags, prop_cache_t *cache, DISPID *id)
+{
+    dispex_prop_t *prop;
+    HRESULT hres;
+
+    if(cache->serial == jsdisp->serial && (prop = get_prop(jsdisp, cache->id))
+       && prop->name && !strcmpW(prop->name, name)) {
+        *id = cache->id;
+        return S_OK;
+    }
+
+    hres = jsdisp_get_id(jsdisp, name, flags, id);
+    if(SUCCEEDED(hres)) {
+        cache->serial = jsdisp->serial;
+        cache->id = *id;
+    }
+    return hres;
+}
+
+HRESULT jsdisp_get_idx_id(jsdisp_t *jsdisp, DWORD idx, DWORD flags, DISPID *id)
+{
+    dispex_prop_t *prop;
+    HRESULT hres;
+
+    hres = find_prop_idx(jsdisp, idx, (flags & fdexNameEnsure) != 0, &prop);
+    if(FAILED(hres))
+        return hres;
+
+    if(prop && prop->type!=PROP_DELETED) {
+        *id = prop_to_id(jsdisp, prop);
+        return S_OK;
+    }
+
+    TRACE("not found %u\n", idx);
+    return DISP_E_UNKNOWNNAME;
+}
+
 HRESULT jsdisp_call_value(jsdisp_t *jsfunc, IDispatch *jsthis, WORD flags, unsigned argc, jsval_t *argv, jsval_t *r)
 {
     HRESULT hres;
@@ -1369,12 +1478,14 @@ HRESULT jsdisp_propput_name(jsdisp_t *obj, const WCHAR *name, jsval_t val)
 
 HRESULT jsdisp_propput_idx(jsdisp_t *obj, DWORD idx, jsval_t val)
 {
-    WCHAR buf[12];
+    dispex_prop_t *prop;
+    HRESULT hres;
 
-    static const WCHAR formatW[] = {'%','d',0};
+    hres = find_prop_idx(obj, idx, TRUE, &prop);
+    if(FAILED(hres))
+        return hres;
 
-    sprintfW(buf, formatW, idx);
-    return jsdisp_propput_name(obj, buf, val);
+    return prop_put(obj, prop, val);
 }
 
 HRESULT disp_propput(script_ctx_t *ctx, IDispatch *disp, DISPID id, jsval_t val)
@@ -1445,15 +1556,10 @@ HRESULT jsdisp_propget_name(jsdisp_t *obj, const WCHAR *name, jsval_t *val)
 
 HRESULT jsdisp_get_idx(jsdisp_t *obj, DWORD idx, jsval_t *r)
 {
-    WCHAR name[12];
     dispex_prop_t *prop;
     HRESULT hres;
 
-    static const WCHAR formatW[] = {'%','d',0};
-
-    sprintfW(name, formatW, idx);
-
-    hres = find_prop_name_prot(obj, string_hash(name), name, &prop);
+    hres = find_prop_idx(obj, idx, FALSE, &prop);
     if(FAILED(hres))
         return hres;
 
@@ -1514,12 +1620,15 @@ HRESULT disp_propget(script_ctx_t *ctx, IDispatch *disp, DISPID id, jsval_t *val
 
 HRESULT jsdisp_delete_idx(jsdisp_t *obj, DWORD idx)
 {
-    static const WCHAR formatW[] = {'%','d',0};
+    static const WCHAR formatW[] = {'%','u',0};
     WCHAR buf[12];
     dispex_prop_t *prop;
     BOOL b;
     HRESULT hres;
 
+    if((prop = get_cached_idx_prop(obj, idx)))
+        return delete_prop(prop, &b);
+
     sprintfW(buf, formatW, idx);
 
     hres = find_prop_name(obj, string_hash(buf), buf, &prop);
@@ -476,6 +476,39 @@ static HRESULT disp_get_id(script_ctx_t *ctx, IDispatch *disp, const WCHAR *name
     return hres;
 }
 
+static HRESULT disp_get_id_cached(script_ctx_t *ctx, IDispatch *disp, const WCHAR *name, BSTR name_bstr, DWORD flags,
+        prop_cache_t *cache, DISPID *id)
+{
+    jsdisp_t *jsdisp;
+    HRESULT hres;
+
+    jsdisp = iface_to_jsdisp(disp);
+    if(!jsdisp)
+        return disp_get_id(ctx, disp, name, name_bstr, flags, id);
+
+    hres = jsdisp_get_id_cached(jsdisp, name, flags, cache, id);
+    jsdisp_release(jsdisp);
+    return hres;
+}
+
+/* get the id of an array index property without converting the index to a string */
+static BOOL get_idx_id(IDispatch *disp, jsval_t name, DWORD flags, DISPID *id, HRESULT *hres)
+{
+    jsdisp_t *jsdisp;
+    double n;
+    DWORD idx;
+
+    if(!is_number(name) || !(jsdisp = to_jsdisp(disp)))
+        return FALSE;
+
+    n = get_number(name);
+    if(!(n >= 0 && n < 4294967296.0) || (idx = n) != n)
+        return FALSE;
+
+    *hres = jsdisp_get_idx_id(jsdisp, idx, flags, id);
+    return TRUE;
+}
+
 static HRESULT disp_cmp(IDispatch *disp1, IDispatch *disp2, BOOL *ret)
 {
     IObjectIdentity *identity;
@@ -625,7 +658,7 @@ local_ref_t *lookup_local(const function_code_t *function, const WCHAR *identifi
 }
 
 /* ECMA-262 3rd Edition    10.1.4 */
-static HRESULT identifier_eval(script_ctx_t *ctx, BSTR identifier, exprval_t *ret)
+static HRESULT identifier_eval(script_ctx_t *ctx, BSTR identifier, prop_cache_t *cache, exprval_t *ret)
 {
     scope_chain_t *scope;
     named_item_t *item;
@@ -665,7 +698,10 @@ static HRESULT identifier_eval(script_ctx_t *ctx, BSTR identifier, exprval_t *re
         }
     }
 
-    hres = jsdisp_get_id(ctx->global, identifier, 0, &id);
+    if(cache)
+        hres = jsdisp_get_id_cached(ctx->global, identifier, 0, cache, &id);
+    else
+        hres = jsdisp_get_id(ctx->global, identifier, 0, &id);
     if(SUCCEEDED(hres)) {
         exprval_set_disp_ref(ret, to_disp(ctx->global), id);
         return S_OK;
@@ -726,6 +762,12 @@ static inline unsigned get_op_int(script_ctx_t *ctx, int i)
     return frame->bytecode->instrs[frame->ip].u.arg[i].lng;
 }
 
+static inline prop_cache_t *get_op_prop_cache(script_ctx_t *ctx, int i)
+{
+    call_frame_t *frame = ctx->call_ctx;
+    return frame->bytecode->prop_caches + frame->bytecode->instrs[frame->ip].u.arg[i].uint;
+}
+
 static inline jsstr_t *get_op_str(script_ctx_t *ctx, int i)
 {
     call_frame_t *frame = ctx->call_ctx;
@@ -1034,15 +1076,17 @@ static HRESULT interp_array(script_ctx_t *ctx)
         return hres;
     }
 
-    hres = to_flat_string(ctx, namev, &name_str, &name);
-    jsval_release(namev);
-    if(FAILED(hres)) {
-        IDispatch_Release(obj);
-        return hres;
-    }
+    if(!get_idx_id(obj, namev, 0, &id, &hres)) {
+        hres = to_flat_string(ctx, namev, &name_str, &name);
+        jsval_release(namev);
+        if(FAILED(hres)) {
+            IDispatch_Release(obj);
+            return hres;
+        }
 
-    hres = disp_get_id(ctx, obj, name, NULL, 0, &id);
-    jsstr_release(name_str);
+        hres = disp_get_id(ctx, obj, name, NULL, 0, &id);
+        jsstr_release(name_str);
+    }
     if(SUCCEEDED(hres)) {
         hres = disp_propget(ctx, obj, id, &v);
     }else if(hres == DISP_E_UNKNOWNNAME) {
@@ -1071,7 +1115,7 @@ static HRESULT interp_member(script_ctx_t *ctx)
     if(FAILED(hres))
         return hres;
 
-    hres = disp_get_id(ctx, obj, arg, arg, 0, &id);
+    hres = disp_get_id_cached(ctx, obj, arg, arg, 0, get_op_prop_cache(ctx, 1), &id);
     if(SUCCEEDED(hres)) {
         hres = disp_propget(ctx, obj, id, &v);
     }else if(hres == DISP_E_UNKNOWNNAME) {
@@ -1104,17 +1148,22 @@ static HRESULT interp_memberid(script_ctx_t *ctx)
 
     hres = to_object(ctx, objv, &obj);
     jsval_release(objv);
-    if(SUCCEEDED(hres)) {
+    if(FAILED(hres)) {
+        jsval_release(namev);
+        return hres;
+    }
+
+    if(!get_idx_id(obj, namev, arg, &id, &hres)) {
         hres = to_flat_string(ctx, namev, &name_str, &name);
-        if(FAILED(hres))
+        jsval_release(namev);
+        if(FAILED(hres)) {
             IDispatch_Release(obj);
-    }
-    jsval_release(namev);
-    if(FAILED(hres))
-        return hres;
+            return hres;
+        }
 
-    hres = disp_get_id(ctx, obj, name, NULL, arg, &id);
-    jsstr_release(name_str);
+        hres = disp_get_id_cached(ctx, obj, name, NULL, arg, get_op_prop_cache(ctx, 1), &id);
+        jsstr_release(name_str);
+    }
     if(SUCCEEDED(hres)) {
         ref.type = EXPRVAL_IDREF;
         ref.u.idref.disp = obj;
@@ -1227,7 +1276,7 @@ static HRESULT interp_identifier_ref(script_ctx_t *ctx, BSTR identifier, unsigne
     exprval_t exprval;
     HRESULT hres;
 
-    hres = identifier_eval(ctx, identifier, &exprval);
+    hres = identifier_eval(ctx, identifier, NULL, &exprval);
     if(FAILED(hres))
         return hres;
 
@@ -1250,13 +1299,13 @@ static HRESULT interp_identifier_ref(script_ctx_t *ctx, BSTR identifier, unsigne
     return stack_push_exprval(ctx, &exprval);
 }
 
-static HRESULT identifier_value(script_ctx_t *ctx, BSTR identifier)
+static HRESULT identifier_value(script_ctx_t *ctx, BSTR identifier, prop_cache_t *cache)
 {
     exprval_t exprval;
     jsval_t v;
     HRESULT hres;
 
-    hres = identifier_eval(ctx, identifier, &exprval);
+    hres = identifier_eval(ctx, identifier, cache, &exprval);
     if(FAILED(hres))
         return hres;
 
@@ -1297,7 +1346,7 @@ static HRESULT interp_local(script_ctx_t *ctx)
     TRACE("%d: %s\n", arg, debugstr_w(local_name(frame, arg)));
 
     if(!frame->base_scope || !frame->base_scope->frame)
-        return identifier_value(ctx, local_name(frame, arg));
+        return identifier_value(ctx, local_name(frame, arg), NULL);
 
     hres = jsval_copy(ctx->stack[local_off(frame, arg)], &copy);
     if(FAILED(hres))
@@ -1313,7 +1362,7 @@ static HRESULT interp_ident(script_ctx_t *ctx)
 
     TRACE("%s\n", debugstr_w(arg));
 
-    return identifier_value(ctx, arg);
+    return identifier_value(ctx, arg, get_op_prop_cache(ctx, 1));
 }
 
 /* ECMA-262 3rd Edition    10.1.4 */
@@ -1876,7 +1925,7 @@ static HRESULT interp_delete_ident(script_ctx_t *ctx)
 
     TRACE("%s\n", debugstr_w(arg));
 
-    hres = identifier_eval(ctx, arg, &exprval);
+    hres = identifier_eval(ctx, arg, NULL, &exprval);
     if(FAILED(hres))
         return hres;
 
@@ -1987,7 +2036,7 @@ static HRESULT interp_typeofident(script_ctx_t *ctx)
 
     TRACE("%s\n", debugstr_w(arg));
 
-    hres = identifier_eval(ctx, arg, &exprval);
+    hres = identifier_eval(ctx, arg, NULL, &exprval);
     if(FAILED(hres))
         return hres;
 
@@ -2839,7 +2888,7 @@ static HRESULT bind_event_target(script_ctx_t *ctx, function_code_t *func, jsdis
     jsval_t v;
     HRESULT hres;
 
-    hres = identifier_eval(ctx, func->event_target, &exprval);
+    hres = identifier_eval(ctx, func->event_target, NULL, &exprval);
     if(FAILED(hres))
         return hres;
 
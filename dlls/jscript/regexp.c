@@ -251,6 +251,9 @@ typedef struct REGlobalData {
     size_t backTrackCount;          /* how many times we've backtracked */
     size_t backTrackLimit;          /* upper limit on backtrack states */
 
+    BOOL hasFirstChar;              /* every match starts with firstChar */
+    WCHAR firstChar;
+
     heap_pool_t *pool;              /* It's faster to use one malloc'd pool
                                        than to malloc/free the three items
                                        that are allocated from this pool */
@@ -2559,6 +2562,13 @@ ExecuteREBytecode(REGlobalData *gData, match_state_t *x)
     if (REOP_IS_SIMPLE(op) && !(gData->regexp->flags & REG_STICKY)) {
         anchor = FALSE;
         while (x->cp <= gData->cpend) {
+            if (gData->hasFirstChar) {
+                startcp = memchrW(x->cp, gData->firstChar, gData->cpend - x->cp);
+                if (!startcp)
+                    startcp = gData->cpend;
+                gData->skipped += startcp - x->cp;
+                x->cp = startcp;
+            }
             nextpc = pc;    /* reset back to start each time */
             result = SimpleMatch(gData, x, op, &nextpc, TRUE);
             if (result) {
@@ -3082,6 +3092,11 @@ static match_state_t *MatchRegExp(REGlobalData *gData, match_state_t *x)
      * in order to detect end-of-input/line condition.
      */
     for (cp2 = cp; cp2 <= gData->cpend; cp2++) {
+        if (gData->hasFirstChar && !(gData->regexp->flags & REG_STICKY)) {
+            cp2 = memchrW(cp2, gData->firstChar, gData->cpend - cp2);
+            if (!cp2)
+                return NULL;
+        }
         gData->skipped = cp2 - cp;
         x->cp = cp2;
         for (j = 0; j < gData->regexp->parenCount; j++)
@@ -3097,6 +3112,37 @@ static match_state_t *MatchRegExp(REGlobalData *gData, match_state_t *x)
     return NULL;
 }
 
+/*
+ * If the program starts with a case sensitive literal, possibly inside
+ * capturing parens, every match has to start with its first character.
+ * That lets us skip over the input with memchrW instead of trying to
+ * match at each position.
+ */
+static BOOL GetFirstChar(regexp_t *re, WCHAR *ret)
+{
+    jsbytecode *pc = re->program;
+    size_t index;
+    REOp op;
+
+    while ((op = (REOp) *pc++) == REOP_LPAREN)
+        pc = ReadCompactIndex(pc, &index);
+
+    switch (op) {
+      case REOP_FLAT:
+        ReadCompactIndex(pc, &index);
+        *ret = re->source[index];
+        return TRUE;
+      case REOP_FLAT1:
+        *ret = *pc;
+        return TRUE;
+      case REOP_UCFLAT1:
+        *ret = GET_ARG(pc);
+        return TRUE;
+      default:
+        return FALSE;
+    }
+}
+
 static HRESULT InitMatch(regexp_t *re, void *cx, heap_pool_t *pool, REGlobalData *gData)
 {
     UINT i;
@@ -3121,6 +3167,7 @@ static HRESULT InitMatch(regexp_t *re, void *cx, heap_pool_t *pool, REGlobalData
     gData->pool = pool;
     gData->regexp = re;
     gData->ok = TRUE;
+    gData->hasFirstChar = GetFirstChar(re, &gData->firstChar);
 
     for (i = 0; i < re->classCount; i++) {
         if (!re->classList[i].converted &&
@@ -999,6 +999,30 @@ ok(arr.sort() === arr, "arr.sort() !== arr");
 for(var i=0; i < arr.length; i++)
     ok(arr[i] === tmp[i], "arr[" + i + "] = " + arr[i] + " expected " + tmp[i]);
 
+arr = [];
+for(var i=0; i < 3000; i++)
+    arr.push(3000-i);
+arr[3500] = 1;
+ok(arr.length === 3501, "arr.length = " + arr.length);
+delete arr[3500];
+arr.length = 3000;
+arr[1000] = "x";
+ok(arr[1000] === "x", "arr[1000] = " + arr[1000]);
+delete arr[1000];
+ok(arr[1000] === undefined, "arr[1000] = " + arr[1000]);
+ok(!(1000 in arr), "1000 in arr");
+arr[1000] = 2000;
+ok(arr["1000"] === 2000, "arr[\"1000\"] = " + arr["1000"]);
+arr.sort(function(x,y) { return x-y; });
+for(var i=0; i < arr.length; i++)
+    if(arr[i] !== i+1) break;
+ok(i === 3000, "arr[" + i + "] = " + arr[i]);
+tmp = arr.join("");
+ok(tmp.length === 10893, "tmp.length = " + tmp.length);
+tmp = 0;
+for(var i in arr) tmp++;
+ok(tmp === 3000, "enumerated " + tmp + " elements");
+
 arr = new Object();
 arr.length = 3;
 arr[0] = 1;
@@ -1832,6 +1832,27 @@ ok(tmp, "tmp = " + tmp);
     ok(x === undefined, "x = " + x);
 })();
 
+(function() {
+    /* member lookups are cached per instruction, make sure they follow the object */
+    function Proto() {}
+    Proto.prototype.prop = "proto";
+
+    var objs = [{prop: 1}, {other: 0, prop: 2}, new Proto(), {}], i, r = "", o;
+
+    for(i = 0; i < 12; i++) {
+        o = objs[i % objs.length];
+        if(i == 8) {
+            delete objs[0].prop;
+            objs[0].prop = 3;
+            delete objs[1].prop;
+            Proto.prototype.prop = "changed";
+        }
+        r += o.prop + ",";
+    }
+    ok(r === "1,2,proto,undefined,1,2,proto,undefined,3,undefined,changed,undefined,",
+       "r = " + r);
+})();
+
 var get, set;
 
 /* NoNewline rule parser tests */
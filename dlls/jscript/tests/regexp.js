@@ -677,4 +677,19 @@ ok(re.ignoreCase === false, "re.ignoreCase = " + re.ignoreCase);
 ok(re.multiline === true, "re.multiline = " + re.multiline);
 ok(re.global === true, "re.global = " + re.global);
 
+tmp = "";
+for(i = 0; i < 100; i++)
+    tmp += "abcabd ";
+m = /(ab)(cx|d) x/.exec(tmp + "abd x");
+ok(m.index === 700, "m.index = " + m.index);
+ok(m[0] === "abd x", "m[0] = " + m[0]);
+ok(m[1] === "ab", "m[1] = " + m[1]);
+m = /abd ab/.exec(tmp);
+ok(m.index === 3, "m.index = " + m.index);
+ok(/abx/.exec(tmp) === null, "/abx/ matched");
+ok(/a/.exec("") === null, "/a/ matched empty string");
+ok(tmp.replace(/(a)bd/g, "$1").length === 500, "tmp.replace(/(a)bd/g) length = " + tmp.replace(/(a)bd/g, "$1").length);
+m = /ABD/i.exec(tmp);
+ok(m.index === 3, "m.index = " + m.index);
+
 reportSuccess();
@@ -584,6 +584,52 @@ static void test_local_error_handling(void)
     }
 }
 
+/* enough atoms for the server hash tables to grow several times */
+static void test_many_atoms(void)
+{
+    static ATOM atoms[10000];
+    char name[32], buf[32];
+    UINT i, len;
+
+    for (i = 0; i < ARRAY_SIZE(atoms); i++)
+    {
+        sprintf( name, "wine_many_atoms_%u", i );
+        atoms[i] = GlobalAddAtomA( name );
+        ok( atoms[i] >= 0xc000, "%u: bad atom id %x\n", i, atoms[i] );
+    }
+    for (i = 0; i < ARRAY_SIZE(atoms); i++)
+    {
+        sprintf( name, "WINE_MANY_ATOMS_%u", i );
+        ok( GlobalFindAtomA( name ) == atoms[i], "%u: could not find atom\n", i );
+        ok( GlobalAddAtomA( name ) == atoms[i], "%u: atom added twice\n", i );
+        len = GlobalGetAtomNameA( atoms[i], buf, sizeof(buf) );
+        sprintf( name, "wine_many_atoms_%u", i );
+        ok( len == strlen(name) && !strcmp( buf, name ), "%u: wrong name %s\n", i, buf );
+    }
+    for (i = 0; i < ARRAY_SIZE(atoms); i++)
+    {
+        sprintf( name, "wine_many_atoms_%u", i );
+        ok( !GlobalDeleteAtom( atoms[i] ), "%u: delete failed\n", i );
+        ok( GlobalFindAtomA( name ) == atoms[i], "%u: could not find atom\n", i );
+        ok( !GlobalDeleteAtom( atoms[i] ), "%u: delete failed\n", i );
+        ok( !GlobalFindAtomA( name ), "%u: found deleted atom\n", i );
+    }
+
+    for (i = 0; i < ARRAY_SIZE(atoms); i++)
+    {
+        sprintf( name, "wine_many_atoms_%u", i );
+        atoms[i] = AddAtomA( name );
+        ok( atoms[i] >= 0xc000, "%u: bad atom id %x\n", i, atoms[i] );
+    }
+    for (i = 0; i < ARRAY_SIZE(atoms); i++)
+    {
+        sprintf( name, "WINE_MANY_ATOMS_%u", i );
+        ok( FindAtomA( name ) == atoms[i], "%u: could not find atom\n", i );
+        ok( !DeleteAtom( atoms[i] ), "%u: delete failed\n", i );
+        ok( !FindAtomA( name ), "%u: found deleted atom\n", i );
+    }
+}
+
 START_TEST(atom)
 {
     /* Global atom table seems to be available to GUI apps only in
@@ -596,4 +642,5 @@ START_TEST(atom)
     test_local_add_atom();
     test_local_get_atom_name();
     test_local_error_handling();
+    test_many_atoms();
 }
@@ -2362,6 +2362,49 @@ static void test_DuplicateHandle(void)
     CloseHandle(out);
 }
 
+static void test_many_handles(void)
+{
+    static HANDLE handles[5000];
+    HANDLE event;
+    DWORD info;
+    BOOL r;
+    int i, j;
+
+    for (i = 0; i < ARRAY_SIZE(handles); i++)
+    {
+        handles[i] = CreateEventA(NULL, FALSE, FALSE, NULL);
+        ok(handles[i] != NULL, "CreateEvent %d failed %u\n", i, GetLastError());
+    }
+    for (i = 0; i < ARRAY_SIZE(handles); i += 2)
+    {
+        r = CloseHandle(handles[i]);
+        ok(r, "CloseHandle %d failed %u\n", i, GetLastError());
+    }
+    for (i = 0; i < ARRAY_SIZE(handles); i += 2)
+    {
+        SetLastError(0xdeadbeef);
+        r = GetHandleInformation(handles[i], &info);
+        ok(!r && GetLastError() == ERROR_INVALID_HANDLE, "%d: got %d error %u\n", i, r, GetLastError());
+    }
+
+    /* the freed entries get reused, and never for a handle that is still open */
+    for (i = 0; i < ARRAY_SIZE(handles); i += 2)
+    {
+        event = CreateEventA(NULL, TRUE, TRUE, NULL);
+        ok(event != NULL, "CreateEvent %d failed %u\n", i, GetLastError());
+        for (j = 1; j < ARRAY_SIZE(handles); j += 2)
+            if (handles[j] == event) break;
+        ok(j >= ARRAY_SIZE(handles), "%d: got handle %p of open event %d\n", i, event, j);
+        handles[i] = event;
+    }
+    for (i = 0; i < ARRAY_SIZE(handles); i++)
+    {
+        ok(WaitForSingleObject(handles[i], 0) == ((i & 1) ? WAIT_TIMEOUT : WAIT_OBJECT_0),
+           "%d: wrong state\n", i);
+        CloseHandle(handles[i]);
+    }
+}
+
 #define test_completion(a, b, c, d, e) _test_completion(__LINE__, a, b, c, d, e)
 static void _test_completion(int line, HANDLE port, DWORD ekey, ULONG_PTR evalue, ULONG_PTR eoverlapped, DWORD wait)
 {
@@ -3862,6 +3905,7 @@ START_TEST(process)
     test_SystemInfo();
     test_RegistryQuota();
     test_DuplicateHandle();
+    test_many_handles();
     test_StartupNoConsole();
     test_DetachConsoleHandles();
     test_DetachStdHandles();
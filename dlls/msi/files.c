@@ -50,7 +50,7 @@
 
 WINE_DEFAULT_DEBUG_CHANNEL(msi);
 
-static void msi_file_update_ui( MSIPACKAGE *package, MSIFILE *f, const WCHAR *action )
+static void msi_file_update_actiondata( MSIPACKAGE *package, MSIFILE *f )
 {
     MSIRECORD *uirow;
 
@@ -60,6 +60,11 @@ static void msi_file_update_ui( MSIPACKAGE *package, MSIFILE *f, const WCHAR *ac
     MSI_RecordSetInteger( uirow, 6, f->FileSize );
     MSI_ProcessMessage(package, INSTALLMESSAGE_ACTIONDATA, uirow);
     msiobj_release( &uirow->hdr );
+}
+
+static void msi_file_update_ui( MSIPACKAGE *package, MSIFILE *f, const WCHAR *action )
+{
+    msi_file_update_actiondata( package, f );
     msi_ui_progress( package, 2, f->FileSize, 0, 0 );
 }
 
@@ -203,7 +208,7 @@ static UINT copy_file(MSIFILE *file, LPWSTR source)
     return ERROR_SUCCESS;
 }
 
-static UINT copy_install_file(MSIPACKAGE *package, MSIFILE *file, LPWSTR source)
+static UINT copy_install_file(MSIFILE *file, LPWSTR source, BOOL *need_reboot)
 {
     UINT gle;
 
@@ -247,7 +252,7 @@ static UINT copy_install_file(MSIPACKAGE *package, MSIFILE *file, LPWSTR source)
             MoveFileExW(file->TargetPath, NULL, MOVEFILE_DELAY_UNTIL_REBOOT) &&
             MoveFileExW(tmpfileW, file->TargetPath, MOVEFILE_DELAY_UNTIL_REBOOT))
         {
-            package->need_reboot_at_end = 1;
+            *need_reboot = TRUE;
             gle = ERROR_SUCCESS;
         }
         else
@@ -262,6 +267,101 @@ static UINT copy_install_file(MSIPACKAGE *package, MSIFILE *file, LPWSTR source)
     return gle;
 }
 
+/* number of uncompressed files copied in the background while the action
+ * goes on with the next files and cabinets */
+#define MAX_PENDING_COPIES 4
+
+struct copy_queue
+{
+    struct list tasks;
+    HANDLE slots;
+    LONG failed;
+};
+
+struct copy_task
+{
+    struct list entry;
+    struct copy_queue *queue;
+    MSIFILE *file;
+    WCHAR *source;
+    UINT error;
+    BOOL need_reboot;
+};
+
+static DWORD WINAPI copy_task_proc( void *arg )
+{
+    struct copy_task *task = arg;
+    struct copy_queue *queue = task->queue;
+
+    if (queue->failed)
+        task->error = ERROR_CANCELLED;
+    else if ((task->error = copy_install_file( task->file, task->source, &task->need_reboot )))
+        InterlockedExchange( &queue->failed, 1 );
+
+    ReleaseSemaphore( queue->slots, 1, NULL );
+    return 0;
+}
+
+static UINT init_copy_queue( struct copy_queue *queue )
+{
+    list_init( &queue->tasks );
+    queue->failed = 0;
+    if (!(queue->slots = CreateSemaphoreW( NULL, MAX_PENDING_COPIES, MAX_PENDING_COPIES, NULL )))
+        return GetLastError();
+    return ERROR_SUCCESS;
+}
+
+static UINT queue_copy( struct copy_queue *queue, MSIFILE *file, WCHAR *source )
+{
+    struct copy_task *task;
+
+    if (!(task = msi_alloc( sizeof(*task) ))) return ERROR_OUTOFMEMORY;
+    task->queue       = queue;
+    task->file        = file;
+    task->source      = source;
+    task->error       = ERROR_SUCCESS;
+    task->need_reboot = FALSE;
+    list_add_tail( &queue->tasks, &task->entry );
+
+    WaitForSingleObject( queue->slots, INFINITE );
+    if (!QueueUserWorkItem( copy_task_proc, task, WT_EXECUTELONGFUNCTION ))
+        copy_task_proc( task );
+    return ERROR_SUCCESS;
+}
+
+/* wait for all pending copies and update the file states in sequence order */
+static UINT finish_copies( MSIPACKAGE *package, struct copy_queue *queue )
+{
+    struct copy_task *task, *next;
+    UINT i, rc = ERROR_SUCCESS;
+
+    if (list_empty( &queue->tasks )) return ERROR_SUCCESS;
+
+    for (i = 0; i < MAX_PENDING_COPIES; i++) WaitForSingleObject( queue->slots, INFINITE );
+
+    LIST_FOR_EACH_ENTRY_SAFE( task, next, &queue->tasks, struct copy_task, entry )
+    {
+        msi_ui_progress( package, 2, task->file->FileSize, 0, 0 );
+        if (task->need_reboot) package->need_reboot_at_end = 1;
+        if (task->error == ERROR_SUCCESS)
+        {
+            if (!msi_is_global_assembly( task->file->Component )) task->file->state = msifs_installed;
+        }
+        else if (task->error != ERROR_CANCELLED && rc == ERROR_SUCCESS)
+        {
+            ERR("Failed to copy %s to %s (%u)\n", debugstr_w(task->source),
+                debugstr_w(task->file->TargetPath), task->error);
+            rc = ERROR_INSTALL_FAILURE;
+        }
+        list_remove( &task->entry );
+        msi_free( task->source );
+        msi_free( task );
+    }
+
+    ReleaseSemaphore( queue->slots, MAX_PENDING_COPIES, NULL );
+    return rc;
+}
+
 static UINT msi_create_directory( MSIPACKAGE *package, const WCHAR *dir )
 {
     MSIFOLDER *folder;
@@ -350,11 +450,15 @@ WCHAR *msi_resolve_file_source( MSIPACKAGE *package, MSIFILE *file )
  * For efficiency, this is done in two passes:
  * 1) Correct all the TargetPaths and determine what files are to be installed.
  * 2) Extract Cabinets and copy files.
+ *
+ * Uncompressed files are copied in the background while cabinets are
+ * extracted, pending copies are completed before switching media.
  */
 UINT ACTION_InstallFiles(MSIPACKAGE *package)
 {
     MSIMEDIAINFO *mi;
-    UINT rc = ERROR_SUCCESS;
+    struct copy_queue queue;
+    UINT rc = ERROR_SUCCESS, r, disk_id = 0;
     MSIFILE *file;
 
     msi_set_sourcedir_props(package, FALSE);
@@ -363,13 +467,14 @@ UINT ACTION_InstallFiles(MSIPACKAGE *package)
         return msi_schedule_action(package, SCRIPT_INSTALL, szInstallFiles);
 
     schedule_install_files(package);
+    if ((rc = init_copy_queue( &queue ))) return rc;
     mi = msi_alloc_zero( sizeof(MSIMEDIAINFO) );
 
     LIST_FOR_EACH_ENTRY( file, &package->files, MSIFILE, entry )
     {
         BOOL is_global_assembly = msi_is_global_assembly( file->Component );
 
-        msi_file_update_ui( package, file, szInstallFiles );
+        msi_file_update_actiondata( package, file );
 
         rc = msi_load_media_info( package, file->Sequence, mi );
         if (rc != ERROR_SUCCESS)
@@ -378,6 +483,16 @@ UINT ACTION_InstallFiles(MSIPACKAGE *package)
             rc = ERROR_FUNCTION_FAILED;
             goto done;
         }
+        if (mi->disk_id != disk_id)
+        {
+            if ((rc = finish_copies( package, &queue ))) goto done;
+            disk_id = mi->disk_id;
+        }
+        if (queue.failed)
+        {
+            rc = finish_copies( package, &queue );
+            goto done;
+        }
 
         if (file->state != msifs_hashmatch &&
             file->state != msifs_skipped &&
@@ -389,7 +504,12 @@ UINT ACTION_InstallFiles(MSIPACKAGE *package)
         }
 
         if (file->state != msifs_missing && !mi->is_continuous && file->state != msifs_overwrite)
+        {
+            msi_ui_progress( package, 2, file->FileSize, 0, 0 );
             continue;
+        }
+        /* the progress of background copies is reported when they complete */
+        if (file->IsCompressed) msi_ui_progress( package, 2, file->FileSize, 0, 0 );
 
         if (file->Sequence > mi->last_sequence || mi->is_continuous ||
             (file->IsCompressed && !mi->is_extracted))
@@ -402,12 +522,21 @@ UINT ACTION_InstallFiles(MSIPACKAGE *package)
             data.cb = installfiles_cb;
             data.user = &cursor;
 
+            /* extracting may prompt for the next disk */
+            if (file->IsCompressed && (mi->type == DRIVE_CDROM || mi->type == DRIVE_REMOVABLE) &&
+                (rc = finish_copies( package, &queue ))) goto done;
+
             if (file->IsCompressed && !msi_cabextract(package, mi, &data))
             {
                 ERR("Failed to extract cabinet: %s\n", debugstr_w(mi->cabinet));
                 rc = ERROR_INSTALL_FAILURE;
                 goto done;
             }
+            if (queue.failed)
+            {
+                rc = finish_copies( package, &queue );
+                goto done;
+            }
         }
 
         if (!file->IsCompressed)
@@ -420,16 +549,17 @@ UINT ACTION_InstallFiles(MSIPACKAGE *package)
             {
                 msi_create_directory(package, file->Component->Directory);
             }
-            rc = copy_install_file(package, file, source);
+            rc = queue_copy(&queue, file, source);
             if (rc != ERROR_SUCCESS)
             {
-                ERR("Failed to copy %s to %s (%u)\n", debugstr_w(source), debugstr_w(file->TargetPath), rc);
-                rc = ERROR_INSTALL_FAILURE;
                 msi_free(source);
                 goto done;
             }
-            if (!is_global_assembly) file->state = msifs_installed;
-            msi_free(source);
+            if (queue.failed)
+            {
+                rc = finish_copies( package, &queue );
+                goto done;
+            }
         }
         else if (!is_global_assembly && file->state != msifs_installed &&
                  !(file->Attributes & msidbFileAttributesPatchAdded))
@@ -439,6 +569,8 @@ UINT ACTION_InstallFiles(MSIPACKAGE *package)
             goto done;
         }
     }
+    if ((rc = finish_copies( package, &queue ))) goto done;
+
     LIST_FOR_EACH_ENTRY( file, &package->files, MSIFILE, entry )
     {
         MSICOMPONENT *comp = file->Component;
@@ -457,6 +589,9 @@ UINT ACTION_InstallFiles(MSIPACKAGE *package)
     }
 
 done:
+    r = finish_copies( package, &queue );
+    if (rc == ERROR_SUCCESS) rc = r;
+    CloseHandle( queue.slots );
     msi_free_media_info(mi);
     return rc;
 }
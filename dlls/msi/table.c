@@ -70,9 +70,15 @@ struct tagMSITABLE
     UINT col_count;
     MSICONDITION persistent;
     INT ref_count;
+    UINT *key_index;        /* hash of the primary key -> first row + 1 */
+    UINT *key_index_next;   /* next row + 1 with the same hash */
+    UINT key_index_size;
     WCHAR name[1];
 };
 
+/* tables smaller than this are searched linearly */
+#define MSITABLE_KEY_INDEX_MIN_ROWS 16
+
 /* information for default tables */
 static const WCHAR szTables[]  = {'_','T','a','b','l','e','s',0};
 static const WCHAR szTable[]   = {'T','a','b','l','e',0};
@@ -369,6 +375,15 @@ static void msi_free_colinfo( MSICOLUMNINFO *colinfo, UINT count )
     for (i = 0; i < count; i++) msi_free( colinfo[i].hash_table );
 }
 
+static void free_key_index( MSITABLE *table )
+{
+    msi_free( table->key_index );
+    msi_free( table->key_index_next );
+    table->key_index = NULL;
+    table->key_index_next = NULL;
+    table->key_index_size = 0;
+}
+
 static void free_table( MSITABLE *table )
 {
     UINT i;
@@ -378,6 +393,7 @@ static void free_table( MSITABLE *table )
     msi_free( table->data_persistent );
     msi_free_colinfo( table->colinfo, table->col_count );
     msi_free( table->colinfo );
+    free_key_index( table );
     msi_free( table );
 }
 
@@ -604,6 +620,9 @@ static UINT get_table( MSIDATABASE *db, LPCWSTR name, MSITABLE **table_ret )
     table->colinfo = NULL;
     table->col_count = 0;
     table->persistent = MSICONDITION_TRUE;
+    table->key_index = NULL;
+    table->key_index_next = NULL;
+    table->key_index_size = 0;
     lstrcpyW( table->name, name );
 
     if (!strcmpW( name, szTables ) || !strcmpW( name, szColumns ))
@@ -741,6 +760,9 @@ UINT msi_create_table( MSIDATABASE *db, LPCWSTR name, column_info *col_info,
     table->colinfo = NULL;
     table->col_count = 0;
     table->persistent = persistent;
+    table->key_index = NULL;
+    table->key_index_next = NULL;
+    table->key_index_size = 0;
     lstrcpyW( table->name, name );
 
     for( col = col_info; col; col = col->next )
@@ -947,6 +969,7 @@ static void msi_update_table_columns( MSIDATABASE *db, LPCWSTR name )
     UINT n;
 
     if (!(table = find_cached_table( db, name ))) return;
+    free_key_index( table );
     old_count = table->col_count;
     msi_free_colinfo( table->colinfo, table->col_count );
     msi_free( table->colinfo );
@@ -1187,6 +1210,8 @@ static UINT table_set_bytes( MSITABLEVIEW *tv, UINT row, UINT col, UINT val )
 
     msi_free( tv->columns[col-1].hash_table );
     tv->columns[col-1].hash_table = NULL;
+    if (tv->columns[col-1].type & MSITYPE_KEY)
+        free_key_index( tv->table );
 
     n = bytes_per_column( tv->db, &tv->columns[col - 1], LONG_STR_BYTES );
     if ( n != 2 && n != 3 && n != 4 )
@@ -1509,6 +1534,8 @@ static UINT table_create_new_row( struct tagMSIVIEW *view, UINT *num, BOOL tempo
     if( !row )
         return ERROR_NOT_ENOUGH_MEMORY;
 
+    free_key_index( tv->table );
+
     row_count = &tv->table->row_count;
     data_ptr = &tv->table->data;
     data_persist_ptr = &tv->table->data_persistent;
@@ -1775,6 +1802,7 @@ static UINT TABLE_delete_row( struct tagMSIVIEW *view, UINT row )
 
     num_rows = tv->table->row_count;
     tv->table->row_count--;
+    free_key_index( tv->table );
 
     /* reset the hash tables */
     for (i = 0; i < tv->num_cols; i++)
@@ -2482,6 +2510,61 @@ static UINT msi_row_matches( MSITABLEVIEW *tv, UINT row, const UINT *data, UINT
     return ret;
 }
 
+static UINT hash_key( MSITABLEVIEW *tv, const UINT *data )
+{
+    UINT i, hash = 0;
+
+    for (i = 0; i < tv->num_cols; i++)
+    {
+        if (tv->columns[i].type & MSITYPE_KEY)
+            hash = hash * 31 + data[i];
+    }
+    return hash;
+}
+
+static UINT build_key_index( MSITABLEVIEW *tv )
+{
+    MSITABLE *table = tv->table;
+    UINT i, j, r, size = table->row_count, *values;
+
+    table->key_index = msi_alloc_zero( size * sizeof(UINT) );
+    table->key_index_next = msi_alloc( size * sizeof(UINT) );
+    values = msi_alloc( tv->num_cols * sizeof(UINT) );
+    if (!table->key_index || !table->key_index_next || !values)
+    {
+        msi_free( values );
+        free_key_index( table );
+        return ERROR_OUTOFMEMORY;
+    }
+    table->key_index_size = size;
+
+    /* insert backwards so that each chain is sorted by row */
+    for (i = table->row_count; i > 0; i--)
+    {
+        UINT hash;
+
+        for (j = 0; j < tv->num_cols; j++)
+        {
+            values[j] = 0;
+            if (~tv->columns[j].type & MSITYPE_KEY)
+                continue;
+            r = TABLE_fetch_int( &tv->view, i - 1, j + 1, &values[j] );
+            if (r != ERROR_SUCCESS)
+            {
+                msi_free( values );
+                free_key_index( table );
+                return r;
+            }
+        }
+        hash = hash_key( tv, values ) % size;
+        table->key_index_next[i - 1] = table->key_index[hash];
+        table->key_index[hash] = i;
+    }
+
+    msi_free( values );
+    return ERROR_SUCCESS;
+}
+
 static UINT msi_table_find_row( MSITABLEVIEW *tv, MSIRECORD *rec, UINT *row, UINT *column )
 {
     UINT i, r = ERROR_FUNCTION_FAILED, *data;
@@ -2489,6 +2572,24 @@ static UINT msi_table_find_row( MSITABLEVIEW *tv, MSIRECORD *rec, UINT *row, UIN
     data = msi_record_to_row( tv, rec );
     if( !data )
         return r;
+
+    if (tv->table->row_count >= MSITABLE_KEY_INDEX_MIN_ROWS &&
+        (tv->table->key_index || build_key_index( tv ) == ERROR_SUCCESS))
+    {
+        for (i = tv->table->key_index[hash_key( tv, data ) % tv->table->key_index_size]; i;
+             i = tv->table->key_index_next[i - 1])
+        {
+            r = msi_row_matches( tv, i - 1, data, column );
+            if (r == ERROR_SUCCESS)
+            {
+                *row = i - 1;
+                break;
+            }
+        }
+        msi_free( data );
+        return r;
+    }
+
     for( i = 0; i < tv->table->row_count; i++ )
     {
         r = msi_row_matches( tv, i, data, column );
@@ -3699,6 +3699,88 @@ static void test_join(void)
     DeleteFileA(msifile);
 }
 
+static void test_large_join(void)
+{
+    MSIHANDLE hdb, hview, hrec;
+    char query[0x100], name[32];
+    DWORD size;
+    UINT r, i, count;
+
+    hdb = create_db();
+    ok( hdb, "failed to create db\n");
+
+    r = run_query( hdb, 0, "CREATE TABLE `Parent` (`Id` SHORT, `Name` CHAR(32) PRIMARY KEY `Id`)" );
+    ok( r == ERROR_SUCCESS, "cannot create table: %d\n", r );
+
+    r = run_query( hdb, 0, "CREATE TABLE `Child` (`Key` CHAR(32), `Parent` SHORT, `ParentName` CHAR(32) PRIMARY KEY `Key`)" );
+    ok( r == ERROR_SUCCESS, "cannot create table: %d\n", r );
+
+    for (i = 0; i < 200; i++)
+    {
+        sprintf( query, "INSERT INTO `Parent` (`Id`, `Name`) VALUES (%u, 'parent%u')", i, i );
+        r = run_query( hdb, 0, query );
+        ok( r == ERROR_SUCCESS, "cannot insert row %u: %d\n", i, r );
+    }
+
+    /* every 10th child has no parent */
+    for (i = 0; i < 1000; i++)
+    {
+        sprintf( query, "INSERT INTO `Child` (`Key`, `Parent`, `ParentName`) VALUES ('child%u', %u, 'parent%u')",
+                 i, i % 10 ? i % 200 : 1000 + i, i % 10 ? i % 200 : 1000 + i );
+        r = run_query( hdb, 0, query );
+        ok( r == ERROR_SUCCESS, "cannot insert row %u: %d\n", i, r );
+    }
+
+    /* duplicate primary keys are found through the key index */
+    r = run_query( hdb, 0, "INSERT INTO `Child` (`Key`, `Parent`, `ParentName`) VALUES ('child567', 0, '')" );
+    ok( r == ERROR_FUNCTION_FAILED, "expected ERROR_FUNCTION_FAILED, got %d\n", r );
+    r = run_query( hdb, 0, "INSERT INTO `Parent` (`Id`, `Name`) VALUES (123, 'dup')" );
+    ok( r == ERROR_FUNCTION_FAILED, "expected ERROR_FUNCTION_FAILED, got %d\n", r );
+
+    r = MsiDatabaseOpenViewA( hdb, "SELECT `Parent`.`Id`, `Child`.`Parent` FROM `Parent`, `Child` "
+                              "WHERE `Child`.`Parent` = `Parent`.`Id`", &hview );
+    ok( r == ERROR_SUCCESS, "failed to open view: %d\n", r );
+    r = MsiViewExecute( hview, 0 );
+    ok( r == ERROR_SUCCESS, "failed to execute view: %d\n", r );
+
+    count = 0;
+    while (MsiViewFetch( hview, &hrec ) == ERROR_SUCCESS)
+    {
+        ok( MsiRecordGetInteger( hrec, 1 ) == MsiRecordGetInteger( hrec, 2 ), "got %d, %d\n",
+            MsiRecordGetInteger( hrec, 1 ), MsiRecordGetInteger( hrec, 2 ) );
+        MsiCloseHandle( hrec );
+        count++;
+    }
+    ok( count == 900, "expected 900 rows, got %u\n", count );
+
+    MsiViewClose( hview );
+    MsiCloseHandle( hview );
+
+    r = MsiDatabaseOpenViewA( hdb, "SELECT `Name`, `Key` FROM `Child`, `Parent` "
+                              "WHERE `ParentName` = `Name` AND `Parent` < 5", &hview );
+    ok( r == ERROR_SUCCESS, "failed to open view: %d\n", r );
+    r = MsiViewExecute( hview, 0 );
+    ok( r == ERROR_SUCCESS, "failed to execute view: %d\n", r );
+
+    count = 0;
+    while (MsiViewFetch( hview, &hrec ) == ERROR_SUCCESS)
+    {
+        size = sizeof(name);
+        r = MsiRecordGetStringA( hrec, 1, name, &size );
+        ok( r == ERROR_SUCCESS, "failed to get string: %d\n", r );
+        ok( !strncmp( name, "parent", 6 ) && atoi( name + 6 ) < 5, "got %s\n", name );
+        MsiCloseHandle( hrec );
+        count++;
+    }
+    ok( count == 20, "expected 20 rows, got %u\n", count );
+
+    MsiViewClose( hview );
+    MsiCloseHandle( hview );
+
+    MsiCloseHandle( hdb );
+    DeleteFileA( msifile );
+}
+
 static void test_temporary_table(void)
 {
     MSICONDITION cond;
@@ -9052,6 +9134,7 @@ START_TEST(db)
     test_handle_limit();
     test_try_transform();
     test_join();
+    test_large_join();
     test_temporary_table();
     test_alter();
     test_integers();
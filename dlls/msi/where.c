@@ -52,6 +52,13 @@ typedef struct tagJOINTABLE
     UINT col_count;
     UINT row_count;
     UINT table_index;
+    /* equality join with a table ordered before this one */
+    const struct expr *join_column;      /* column of this table */
+    const struct expr *join_key;         /* column of the other table */
+    UINT join_value;                     /* value of join_key being looked up */
+    UINT *hash_buckets;                  /* first row + 1 per bucket */
+    UINT *hash_next;                     /* next row + 1 in the same bucket */
+    UINT *hash_values;                   /* value of join_column per row */
 } JOINTABLE;
 
 typedef struct tagMSIORDERINFO
@@ -647,16 +654,133 @@ static UINT WHERE_evaluate( MSIWHEREVIEW *wv, const UINT rows[],
     return ERROR_SUCCESS;
 }
 
+static void free_hash_join( JOINTABLE *table )
+{
+    msi_free( table->hash_buckets );
+    msi_free( table->hash_next );
+    msi_free( table->hash_values );
+    table->hash_buckets = table->hash_next = table->hash_values = NULL;
+    table->join_column = table->join_key = NULL;
+}
+
+static UINT build_hash_join( JOINTABLE *table )
+{
+    UINT i, r, hash;
+
+    if (!table->join_column)
+        return ERROR_SUCCESS;
+
+    table->hash_buckets = msi_alloc_zero( table->row_count * sizeof(UINT) );
+    table->hash_next = msi_alloc( table->row_count * sizeof(UINT) );
+    table->hash_values = msi_alloc( table->row_count * sizeof(UINT) );
+    if (!table->hash_buckets || !table->hash_next || !table->hash_values)
+        return ERROR_OUTOFMEMORY;
+
+    /* insert backwards so that each bucket is sorted by row */
+    for (i = table->row_count; i > 0; i--)
+    {
+        r = table->view->ops->fetch_int( table->view, i - 1, table->join_column->u.column.parsed.column,
+                                         &table->hash_values[i - 1] );
+        if (r != ERROR_SUCCESS)
+            return r;
+
+        hash = table->hash_values[i - 1] % table->row_count;
+        table->hash_next[i - 1] = table->hash_buckets[hash];
+        table->hash_buckets[hash] = i;
+    }
+    return ERROR_SUCCESS;
+}
+
+static inline BOOL is_column( const struct expr *expr )
+{
+    return expr->type == EXPR_COL_NUMBER || expr->type == EXPR_COL_NUMBER32 ||
+           expr->type == EXPR_COL_NUMBER_STRING;
+}
+
+static int table_position( JOINTABLE **ordered_tables, const JOINTABLE *table )
+{
+    int i;
+
+    for (i = 0; ordered_tables[i]; i++)
+        if (ordered_tables[i] == table)
+            return i;
+    return -1;
+}
+
+/*
+ * Looks for "a.x = b.y" terms ANDed to the condition. Rows of the table
+ * evaluated later can then be found by hash instead of scanning all of them,
+ * the whole condition is still evaluated for each candidate row.
+ */
+static void find_hash_joins( const struct expr *cond, JOINTABLE **ordered_tables )
+{
+    const struct expr *left, *right, *tmp;
+    JOINTABLE *table;
+
+    if (cond->type != EXPR_COMPLEX && cond->type != EXPR_STRCMP)
+        return;
+
+    left = cond->u.expr.left;
+    right = cond->u.expr.right;
+
+    if (cond->type == EXPR_COMPLEX && cond->u.expr.op == OP_AND)
+    {
+        find_hash_joins( left, ordered_tables );
+        find_hash_joins( right, ordered_tables );
+        return;
+    }
+
+    /* only values stored the same way compare equal when their ids do */
+    if (cond->u.expr.op != OP_EQ || !is_column( left ) || left->type != right->type ||
+        left->u.column.parsed.table == right->u.column.parsed.table)
+        return;
+
+    if (table_position( ordered_tables, left->u.column.parsed.table ) <
+        table_position( ordered_tables, right->u.column.parsed.table ))
+    {
+        tmp = left;
+        left = right;
+        right = tmp;
+    }
+
+    table = left->u.column.parsed.table;
+    if (!table->join_column)
+    {
+        table->join_column = left;
+        table->join_key = right;
+    }
+}
+
+static UINT next_join_row( const JOINTABLE *table, UINT row )
+{
+    for (; row; row = table->hash_next[row - 1])
+    {
+        if (table->hash_values[row - 1] == table->join_value)
+            break;
+    }
+    return row;
+}
+
 static UINT check_condition( MSIWHEREVIEW *wv, MSIRECORD *record, JOINTABLE **tables,
                              UINT table_rows[] )
 {
-    UINT r = ERROR_FUNCTION_FAILED;
+    JOINTABLE *table = *tables;
+    UINT r = ERROR_SUCCESS, row;
+    BOOL use_hash = FALSE;
     INT val;
 
-    for (table_rows[(*tables)->table_index] = 0;
-         table_rows[(*tables)->table_index] < (*tables)->row_count;
-         table_rows[(*tables)->table_index]++)
+    /* null strings compare equal to empty ones, leave them to the full scan */
+    if (table->hash_buckets &&
+        expr_fetch_value( &table->join_key->u.column, table_rows, &table->join_value ) == ERROR_SUCCESS &&
+        (table->join_value || table->join_key->type != EXPR_COL_NUMBER_STRING))
+        use_hash = TRUE;
+
+    /* row numbers are biased by one here, 0 ends the iteration */
+    row = use_hash ? next_join_row( table, table->hash_buckets[table->join_value % table->row_count] ) : 1;
+    for (; row && row <= table->row_count;
+         row = use_hash ? next_join_row( table, table->hash_next[row - 1] ) : row + 1)
     {
+        table_rows[table->table_index] = row - 1;
         val = 0;
         wv->rec_index = 0;
         r = WHERE_evaluate( wv, table_rows, wv->cond, &val, record );
@@ -831,6 +955,7 @@ static UINT WHERE_execute( struct tagMSIVIEW *view, MSIRECORD *record )
 
     do
     {
+        free_hash_join(table);
         table->view->ops->execute(table->view, NULL);
 
         r = table->view->ops->get_dimensions(table->view, &table->row_count, NULL);
@@ -848,6 +973,19 @@ static UINT WHERE_execute( struct tagMSIVIEW *view, MSIRECORD *record )
 
     ordered_tables = ordertables( wv );
 
+    if (wv->cond)
+    {
+        find_hash_joins( wv->cond, ordered_tables );
+        for (table = wv->tables; table; table = table->next)
+        {
+            if (build_hash_join( table ) != ERROR_SUCCESS)
+            {
+                WARN("failed to build hash for join, falling back to scanning\n");
+                free_hash_join( table );
+            }
+        }
+    }
+
     rows = msi_alloc( wv->table_count * sizeof(*rows) );
     for (i = 0; i < wv->table_count; i++)
         rows[i] = INVALID_ROW_INDEX;
@@ -878,7 +1016,10 @@ static UINT WHERE_close( struct tagMSIVIEW *view )
         return ERROR_FUNCTION_FAILED;
 
     do
+    {
+        free_hash_join(table);
         table->view->ops->close(table->view);
+    }
     while ((table = table->next));
 
     return ERROR_SUCCESS;
@@ -1043,6 +1184,7 @@ static UINT WHERE_delete( struct tagMSIVIEW *view )
     {
         JOINTABLE *next;
 
+        free_hash_join(table);
         table->view->ops->delete(table->view);
         table->view = NULL;
         next = table->next;
@@ -1250,7 +1392,7 @@ UINT WHERE_CreateView( MSIDATABASE *db, MSIVIEW **view, LPWSTR tables,
         if ((ptr = strchrW(tables, ' ')))
             *ptr = '\0';
 
-        table = msi_alloc(sizeof(JOINTABLE));
+        table = msi_alloc_zero(sizeof(JOINTABLE));
         if (!table)
         {
             r = ERROR_OUTOFMEMORY;
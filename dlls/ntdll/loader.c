@@ -3016,6 +3016,7 @@ void WINAPI LdrShutdownProcess(void)
     TRACE("()\n");
     process_detaching = TRUE;
     process_detach();
+    server_dump_stats();
 }
 
 
@@ -83,6 +83,7 @@
 #include "ntdll_misc.h"
 
 WINE_DEFAULT_DEBUG_CHANNEL(server);
+WINE_DECLARE_DEBUG_CHANNEL(serverstats);
 
 /* Some versions of glibc don't define this */
 #ifndef SCM_RIGHTS
@@ -277,16 +278,76 @@ static inline unsigned int wait_reply( struct __server_request_info *req )
 }
 
 
+/* round trip statistics of server calls, collected with +serverstats */
+struct server_call_stats
+{
+    LONG     calls;          /* number of calls */
+    LONGLONG time;           /* total round trip time, in 100ns ticks */
+    LONG     histogram[24];  /* number of calls by log2 of the round trip time in ticks */
+};
+
+static struct server_call_stats call_stats[REQ_NB_REQUESTS];
+
+static void add_call_stats( enum request req, ULONGLONG time )
+{
+    struct server_call_stats *stats = &call_stats[req];
+    unsigned int bucket = 0;
+    LONGLONG old;
+
+    while (bucket < ARRAY_SIZE(stats->histogram) - 1 && (time >> (bucket + 1))) bucket++;
+    interlocked_xchg_add( &stats->calls, 1 );
+    interlocked_xchg_add( &stats->histogram[bucket], 1 );
+    do old = stats->time;
+    while (interlocked_cmpxchg64( &stats->time, old + time, old ) != old);
+}
+
+/***********************************************************************
+ *           server_dump_stats
+ *
+ * Print the round trip statistics of the server calls made by the process.
+ */
+void server_dump_stats(void)
+{
+    unsigned int i, j, total, limit;
+
+    if (!TRACE_ON(serverstats)) return;
+
+    for (i = 0; i < REQ_NB_REQUESTS; i++)
+    {
+        const struct server_call_stats *stats = &call_stats[i];
+
+        if (!stats->calls) continue;
+        limit = stats->calls - stats->calls / 100;
+        for (j = total = 0; j < ARRAY_SIZE(stats->histogram) - 1; j++)
+            if ((total += stats->histogram[j]) >= limit) break;
+        TRACE_(serverstats)( "request %3u: %u calls, %s us total, %u us avg, p99 < %u us\n", i,
+                             stats->calls, wine_dbgstr_longlong( stats->time / 10 ),
+                             (unsigned int)(stats->time / stats->calls / 10), ((2u << j) + 9) / 10 );
+    }
+}
+
+
 /***********************************************************************
  *           server_call_unlocked
  */
 unsigned int server_call_unlocked( void *req_ptr )
 {
     struct __server_request_info * const req = req_ptr;
+    enum request code = req->u.req.request_header.req;
+    LARGE_INTEGER start, end;
     unsigned int ret;
 
-    if ((ret = send_request( req ))) return ret;
-    return wait_reply( req );
+    if (!TRACE_ON(serverstats) || code >= REQ_NB_REQUESTS)
+    {
+        if ((ret = send_request( req ))) return ret;
+        return wait_reply( req );
+    }
+
+    NtQueryPerformanceCounter( &start, NULL );
+    if (!(ret = send_request( req ))) ret = wait_reply( req );
+    NtQueryPerformanceCounter( &end, NULL );
+    add_call_stats( code, end.QuadPart - start.QuadPart );
+    return ret;
 }
 
 
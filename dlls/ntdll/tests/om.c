@@ -2113,6 +2113,45 @@ static void test_wait_on_address(void)
     ok(address == 0, "got %s\n", wine_dbgstr_longlong(address));
 }
 
+static void test_many_names(void)
+{
+    static HANDLE events[3000];
+    char name[64];
+    HANDLE handle;
+    UINT i;
+
+    for (i = 0; i < ARRAY_SIZE(events); i++)
+    {
+        sprintf( name, "om_many_names_%u", i );
+        events[i] = CreateEventA( NULL, FALSE, FALSE, name );
+        ok( events[i] != NULL, "%u: CreateEvent failed %u\n", i, GetLastError() );
+    }
+    for (i = 0; i < ARRAY_SIZE(events); i++)
+    {
+        sprintf( name, "OM_MANY_NAMES_%u", i );
+        handle = OpenEventA( EVENT_MODIFY_STATE, FALSE, name );
+        ok( handle != NULL, "%u: OpenEvent failed %u\n", i, GetLastError() );
+        SetEvent( handle );
+        ok( !WaitForSingleObject( events[i], 0 ), "%u: opened the wrong event\n", i );
+        CloseHandle( handle );
+    }
+    for (i = 0; i < ARRAY_SIZE(events); i += 2) CloseHandle( events[i] );
+    for (i = 0; i < ARRAY_SIZE(events); i++)
+    {
+        sprintf( name, "om_many_names_%u", i );
+        SetLastError( 0xdeadbeef );
+        handle = OpenEventA( EVENT_MODIFY_STATE, FALSE, name );
+        if (i % 2)
+        {
+            ok( handle != NULL, "%u: OpenEvent failed %u\n", i, GetLastError() );
+            CloseHandle( handle );
+            CloseHandle( events[i] );
+        }
+        else ok( !handle && GetLastError() == ERROR_FILE_NOT_FOUND,
+                 "%u: got %p error %u\n", i, handle, GetLastError() );
+    }
+}
+
 START_TEST(om)
 {
     HMODULE hntdll = GetModuleHandleA("ntdll.dll");
@@ -2184,4 +2223,5 @@ START_TEST(om)
     test_keyed_events();
     test_null_device();
     test_wait_on_address();
+    test_many_names();
 }
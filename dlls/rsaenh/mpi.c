@@ -1250,7 +1250,7 @@ mp_mod_2d (const mp_int * a, int b, mp_int * c)
     c->dp[x] = 0;
   }
   /* clear the digit that is not completely outside/inside the modulus */
-  c->dp[b / DIGIT_BIT] &= (1 << ((mp_digit)b % DIGIT_BIT)) - 1;
+  c->dp[b / DIGIT_BIT] &= ((mp_digit)1 << (b % DIGIT_BIT)) - (mp_digit)1;
   mp_clamp (c);
   return MP_OKAY;
 }
@@ -3093,6 +3093,9 @@ mp_montgomery_setup (const mp_int * n, mp_digit * rho)
   x *= 2 - b * x;               /* here x*a==1 mod 2**8 */
   x *= 2 - b * x;               /* here x*a==1 mod 2**16 */
   x *= 2 - b * x;               /* here x*a==1 mod 2**32 */
+#if DIGIT_BIT > 32
+  x *= 2 - b * x;               /* here x*a==1 mod 2**64 */
+#endif
 
   /* rho = -1/m mod b */
   *rho = (((mp_word)1 << ((mp_word) DIGIT_BIT)) - x) & MP_MASK;
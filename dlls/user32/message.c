@@ -2740,6 +2740,123 @@ static inline void call_sendmsg_callback( SENDASYNCPROC callback, HWND hwnd, UIN
 }
 
 
+/* client view of the server queue state, see get_msg_queue */
+struct user_queue_shm
+{
+    const queue_shm_t *shm;           /* shared queue state */
+    DWORD              last_get_msg;  /* tick count of the last get_message request */
+    unsigned int       hooks_serial;  /* hooks serial when active_hooks was last refreshed */
+};
+
+/* full memory barrier, like MemoryBarrier() in the Windows headers */
+static inline void shared_queue_barrier(void)
+{
+    LONG dummy;
+    InterlockedExchange( &dummy, 0 );
+}
+
+/***********************************************************************
+ *           read_shared_queue
+ *
+ * Read a consistent snapshot of the shared queue state, see update_queue_shm in the server.
+ */
+static BOOL read_shared_queue( DWORD *wake_bits, DWORD *changed_bits, DWORD *wait_mask,
+                               unsigned int *hooks_serial )
+{
+    struct user_queue_shm *queue_shm = get_user_thread_info()->queue_shm;
+    const volatile queue_shm_t *shm;
+    unsigned int seq;
+
+    if (!queue_shm) return FALSE;
+    shm = queue_shm->shm;
+    for (;;)
+    {
+        seq           = shm->seq;
+        shared_queue_barrier();
+        *wake_bits    = shm->wake_bits;
+        *changed_bits = shm->changed_bits;
+        *wait_mask    = shm->wake_mask | shm->changed_mask;
+        *hooks_serial = shm->hooks_serial;
+        shared_queue_barrier();
+        if (!(seq & 1) && seq == shm->seq) return TRUE;
+    }
+}
+
+/***********************************************************************
+ *           get_shared_queue_bits
+ *
+ * Read the queue bits without a server round trip.
+ */
+BOOL get_shared_queue_bits( DWORD *wake_bits, DWORD *changed_bits )
+{
+    unsigned int hooks_serial;
+    DWORD wait_mask;
+
+    return read_shared_queue( wake_bits, changed_bits, &wait_mask, &hooks_serial );
+}
+
+/***********************************************************************
+ *           free_shared_queue
+ */
+void free_shared_queue( struct user_thread_info *thread_info )
+{
+    if (!thread_info->queue_shm) return;
+    UnmapViewOfFile( (void *)thread_info->queue_shm->shm );
+    HeapFree( GetProcessHeap(), 0, thread_info->queue_shm );
+    thread_info->queue_shm = NULL;
+}
+
+/***********************************************************************
+ *           map_shared_queue
+ */
+static void map_shared_queue( struct user_thread_info *thread_info, HANDLE mapping )
+{
+    struct user_queue_shm *queue_shm;
+    void *ptr;
+
+    if ((ptr = MapViewOfFile( mapping, FILE_MAP_READ, 0, 0, sizeof(queue_shm_t) )))
+    {
+        if ((queue_shm = HeapAlloc( GetProcessHeap(), 0, sizeof(*queue_shm) )))
+        {
+            queue_shm->shm = ptr;
+            queue_shm->last_get_msg = GetTickCount();
+            queue_shm->hooks_serial = ~0u;  /* force a get_message request first */
+            thread_info->queue_shm = queue_shm;
+        }
+        else UnmapViewOfFile( ptr );
+    }
+    CloseHandle( mapping );
+}
+
+static HANDLE get_server_queue_handle(void);
+
+/***********************************************************************
+ *           check_shared_queue
+ *
+ * Check whether a get_message request could return anything, using the queue
+ * state shared with the server. Returns FALSE only if the queue is known to be empty.
+ */
+static BOOL check_shared_queue( HWND hwnd, UINT flags, UINT changed_mask )
+{
+    struct user_thread_info *thread_info = get_user_thread_info();
+    UINT filter = (flags >> 16) ? (flags >> 16) : QS_ALLINPUT;
+    DWORD wake_bits, changed_bits, wait_mask;
+    unsigned int hooks_serial;
+
+    /* the request also arms the wait masks, and signals the idle event for HWND_TOPMOST */
+    if (changed_mask || hwnd == HWND_TOPMOST) return TRUE;
+    if (!thread_info->queue_shm && !get_server_queue_handle()) return TRUE;
+    if (!read_shared_queue( &wake_bits, &changed_bits, &wait_mask, &hooks_serial )) return TRUE;
+    /* the request would clear the wait masks left armed by a previous wait */
+    if (wait_mask) return TRUE;
+    /* the request refreshes active_hooks */
+    if (hooks_serial != thread_info->queue_shm->hooks_serial) return TRUE;
+    /* the server considers the queue hung if it doesn't hear from us for 5 seconds */
+    if (GetTickCount() - thread_info->queue_shm->last_get_msg >= 3000) return TRUE;
+    return (wake_bits & (filter | QS_SENDMESSAGE)) != 0;
+}
+
+
 /***********************************************************************
  *           peek_message
  *
@@ -2756,18 +2873,25 @@ static BOOL peek_message( MSG *msg, HWND hwnd, UINT first, UINT last, UINT flags
     void *buffer;
     size_t buffer_size = 256;
 
-    if (!(buffer = HeapAlloc( GetProcessHeap(), 0, buffer_size ))) return FALSE;
-
     if (!first && !last) last = ~0;
     if (hwnd == HWND_BROADCAST) hwnd = HWND_TOPMOST;
 
+    if (!check_shared_queue( hwnd, flags, changed_mask )) return FALSE;
+    if (!(buffer = HeapAlloc( GetProcessHeap(), 0, buffer_size ))) return FALSE;
+
     for (;;)
     {
         NTSTATUS res;
         size_t size = 0;
         const message_data_t *msg_data = buffer;
+        unsigned int hooks_serial = 0;
 
         thread_info->msg_source = prev_source;
+        if (thread_info->queue_shm)
+        {
+            hooks_serial = *(volatile const unsigned int *)&thread_info->queue_shm->shm->hooks_serial;
+            shared_queue_barrier();
+        }
 
         SERVER_START_REQ( get_message )
         {
@@ -2793,10 +2917,20 @@ static BOOL peek_message( MSG *msg, HWND hwnd, UINT first, UINT last, UINT flags
                 hw_id            = 0;
                 thread_info->active_hooks = reply->active_hooks;
             }
-            else buffer_size = reply->total;
+            else
+            {
+                buffer_size = reply->total;
+                if (res == STATUS_PENDING) thread_info->active_hooks = reply->active_hooks;
+            }
         }
         SERVER_END_REQ;
 
+        if (thread_info->queue_shm)
+        {
+            thread_info->queue_shm->last_get_msg = GetTickCount();
+            if (!res || res == STATUS_PENDING) thread_info->queue_shm->hooks_serial = hooks_serial;
+        }
+
         if (res)
         {
             HeapFree( GetProcessHeap(), 0, buffer );
@@ -3002,7 +3136,7 @@ static inline void process_sent_messages(void)
 static HANDLE get_server_queue_handle(void)
 {
     struct user_thread_info *thread_info = get_user_thread_info();
-    HANDLE ret;
+    HANDLE ret, shm = 0;
 
     if (!(ret = thread_info->server_queue))
     {
@@ -3010,10 +3144,12 @@ static HANDLE get_server_queue_handle(void)
         {
             wine_server_call( req );
             ret = wine_server_ptr_handle( reply->handle );
+            shm = wine_server_ptr_handle( reply->shm );
         }
         SERVER_END_REQ;
         thread_info->server_queue = ret;
         if (!ret) ERR( "Cannot get server thread queue\n" );
+        if (shm) map_shared_queue( thread_info, shm );
     }
     return ret;
 }
@@ -12462,6 +12462,54 @@ static const struct message WmStopQuitSeq[] = {
     { 0 }
 };
 
+static DWORD WINAPI post_thread_message_proc(void *param)
+{
+    BOOL ret = PostThreadMessageA(PtrToUlong(param), WM_USER, 1, 2);
+    ok(ret, "PostThreadMessageA failed, error %u\n", GetLastError());
+    return 0;
+}
+
+static void test_PeekMessage_other_thread(void)
+{
+    HANDLE thread;
+    DWORD status, tid;
+    BOOL ret;
+    MSG msg;
+
+    while (PeekMessageA(&msg, 0, 0, 0, PM_REMOVE)) DispatchMessageA(&msg);
+    GetQueueStatus(QS_ALLINPUT);
+
+    ret = PeekMessageA(&msg, 0, 0, 0, PM_NOREMOVE);
+    ok(!ret, "got message %04x\n", msg.message);
+    status = GetQueueStatus(QS_POSTMESSAGE);
+    ok(status == 0, "wrong status %08x\n", status);
+
+    thread = CreateThread(NULL, 0, post_thread_message_proc, ULongToPtr(GetCurrentThreadId()), 0, &tid);
+    ok(thread != NULL, "CreateThread failed, error %u\n", GetLastError());
+    WaitForSingleObject(thread, INFINITE);
+    CloseHandle(thread);
+
+    /* the message posted by the other thread must be visible without waiting */
+    status = GetQueueStatus(QS_POSTMESSAGE);
+    ok(status == MAKELONG(QS_POSTMESSAGE, QS_POSTMESSAGE), "wrong status %08x\n", status);
+    status = GetQueueStatus(QS_POSTMESSAGE);
+    ok(status == MAKELONG(0, QS_POSTMESSAGE), "wrong status %08x\n", status);
+    ok(!GetInputState(), "GetInputState returned TRUE\n");
+
+    ret = PeekMessageA(&msg, 0, 0, 0, PM_NOREMOVE);
+    ok(ret, "no message available\n");
+    ok(msg.message == WM_USER, "got message %04x\n", msg.message);
+    ret = PeekMessageA(&msg, 0, 0, 0, PM_REMOVE);
+    ok(ret, "no message available\n");
+    ok(msg.message == WM_USER && msg.wParam == 1 && msg.lParam == 2,
+       "got message %04x %lx %lx\n", msg.message, msg.wParam, msg.lParam);
+
+    ret = PeekMessageA(&msg, 0, 0, 0, PM_NOREMOVE);
+    ok(!ret, "got message %04x\n", msg.message);
+    status = GetQueueStatus(QS_POSTMESSAGE);
+    ok(status == 0, "wrong status %08x\n", status);
+}
+
 static void test_quit_message(void)
 {
     MSG msg;
@@ -17612,6 +17660,7 @@ START_TEST(msg)
     test_PeekMessage();
     test_PeekMessage2();
     test_PeekMessage3();
+    test_PeekMessage_other_thread();
     test_WaitForInputIdle( test_argv[0] );
     test_scrollwindowex();
     test_messages();
@@ -1302,6 +1302,79 @@ static void resolve_labels(compile_ctx_t *ctx, unsigned off)
     ctx->labels_cnt = 0;
 }
 
+static BOOL lookup_local(function_t *func, const WCHAR *name, int *ret)
+{
+    unsigned i;
+
+    /* assignments to the function name store the return value */
+    if(!strcmpiW(name, func->name))
+        return FALSE;
+
+    for(i = 0; i < func->var_cnt; i++) {
+        if(!strcmpiW(func->vars[i].name, name)) {
+            *ret = i;
+            return TRUE;
+        }
+    }
+
+    for(i = 0; i < func->arg_cnt; i++) {
+        if(!strcmpiW(func->args[i].name, name)) {
+            *ret = -(int)i-1;
+            return TRUE;
+        }
+    }
+
+    return FALSE;
+}
+
+/*
+ * Dim statements may follow the code using the variable, so locals and
+ * arguments are bound to their slots once the whole function is compiled.
+ * Other identifiers are still looked up by name at runtime.
+ */
+static void resolve_locals(compile_ctx_t *ctx, function_t *func)
+{
+    instr_t *instr;
+    int slot;
+
+    for(instr = ctx->code->instrs+func->code_off; instr < ctx->code->instrs+ctx->instr_cnt; instr++) {
+        switch(instr->op) {
+        case OP_icall:
+            if(lookup_local(func, instr->arg1.bstr, &slot)) {
+                instr->op = OP_local;
+                instr->arg1.lng = slot;
+            }
+            break;
+        case OP_assign_ident:
+            if(lookup_local(func, instr->arg1.bstr, &slot)) {
+                instr->op = OP_assign_local;
+                instr->arg1.lng = slot;
+            }
+            break;
+        case OP_set_ident:
+            if(lookup_local(func, instr->arg1.bstr, &slot)) {
+                instr->op = OP_set_local;
+                instr->arg1.lng = slot;
+            }
+            break;
+        case OP_incc:
+            if(lookup_local(func, instr->arg1.bstr, &slot)) {
+                instr->op = OP_incc_local;
+                instr->arg1.lng = slot;
+            }
+            break;
+        case OP_step:
+            if(lookup_local(func, instr->arg2.bstr, &slot)) {
+                instr->op = OP_step_local;
+                instr->arg2.lng = slot;
+            }
+            break;
+        default:
+            break;
+        }
+    }
+}
+
 static HRESULT fill_array_desc(compile_ctx_t *ctx, dim_decl_t *dim_decl, array_desc_t *array_desc)
 {
     unsigned dim_cnt = 0, i;
@@ -1417,6 +1490,9 @@ static HRESULT compile_func(compile_ctx_t *ctx, statement_t *stat, function_t *f
         }
     }
 
+    if(func->type != FUNC_GLOBAL)
+        resolve_locals(ctx, func);
+
     if(func->array_cnt) {
         unsigned array_id = 0;
         dim_decl_t *dim_decl;
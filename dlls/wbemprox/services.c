@@ -857,6 +857,7 @@ static HRESULT WINAPI wbem_services_ExecMethod(
     if (hr != S_OK) goto done;
 
     hr = func( obj, pInParams, ppOutParams );
+    invalidate_tables();
 
 done:
     if (result) IEnumWbemClassObject_Release( result );
@@ -23,6 +23,7 @@
 
 #include "windef.h"
 #include "winbase.h"
+#include "winreg.h"
 #include "wbemcli.h"
 
 #include "wine/debug.h"
@@ -304,6 +305,7 @@ void clear_table( struct table *table )
 {
     UINT i;
 
+    table->flags &= ~TABLE_FLAG_CACHED;
     if (!table->data) return;
 
     for (i = 0; i < table->num_rows; i++) free_row_values( table, i );
@@ -316,6 +318,88 @@ void clear_table( struct table *table )
     }
 }
 
+/* HKCU\Software\Wine\WBEM\CacheTimeout holds the default snapshot lifetime
+ * in milliseconds, values named after a class override it for that class */
+static DWORD get_cache_timeout( const WCHAR *name )
+{
+    static const WCHAR cache_timeoutW[] =
+        {'S','o','f','t','w','a','r','e','\\','W','i','n','e','\\','W','B','E','M','\\',
+         'C','a','c','h','e','T','i','m','e','o','u','t',0};
+    DWORD timeout = 0, value, type, size = sizeof(value);
+    HKEY hkey;
+
+    if (RegOpenKeyExW( HKEY_CURRENT_USER, cache_timeoutW, 0, KEY_READ, &hkey )) return 0;
+    if (!RegQueryValueExW( hkey, name, NULL, &type, (BYTE *)&value, &size ) && type == REG_DWORD)
+        timeout = value;
+    else
+    {
+        size = sizeof(value);
+        if (!RegQueryValueExW( hkey, NULL, NULL, &type, (BYTE *)&value, &size ) && type == REG_DWORD)
+            timeout = value;
+    }
+    RegCloseKey( hkey );
+    TRACE("%s snapshots expire after %u ms\n", debugstr_w(name), timeout);
+    return timeout;
+}
+
+static BOOL is_snapshot_valid( const struct table *table )
+{
+    return (table->flags & TABLE_FLAG_CACHED) && GetTickCount() - table->fill_time < table->cache_timeout;
+}
+
+/* free the rows of unused builtin tables whose snapshot has expired */
+static void free_expired_snapshots( void )
+{
+    struct table *table;
+
+    LIST_FOR_EACH_ENTRY( table, table_list, struct table, entry )
+    {
+        if ((table->flags & (TABLE_FLAG_DYNAMIC | TABLE_FLAG_CACHED)) != TABLE_FLAG_CACHED) continue;
+        if (!table->refs && !is_snapshot_valid( table )) clear_table( table );
+    }
+}
+
+void fill_table( struct table *table, const struct expr *cond )
+{
+    enum fill_status status;
+
+    free_expired_snapshots();
+    if (!(table->flags & TABLE_FLAG_CACHE_TIMEOUT))
+    {
+        table->cache_timeout = get_cache_timeout( table->name );
+        table->flags |= TABLE_FLAG_CACHE_TIMEOUT;
+    }
+    if (is_snapshot_valid( table ))
+    {
+        TRACE("using cached rows for %s\n", debugstr_w(table->name));
+        return;
+    }
+
+    clear_table( table );
+    status = table->fill( table, cond );
+
+    /* filtered rows can't be reused for a different condition */
+    if (status == FILL_STATUS_UNFILTERED && table->cache_timeout)
+    {
+        table->fill_time = GetTickCount();
+        table->flags |= TABLE_FLAG_CACHED;
+    }
+}
+
+/* methods may create or destroy objects of any class, e.g. starting a
+ * service also creates a process */
+void invalidate_tables( void )
+{
+    struct table *table;
+
+    LIST_FOR_EACH_ENTRY( table, table_list, struct table, entry )
+    {
+        if (!(table->flags & TABLE_FLAG_CACHED)) continue;
+        if (!table->refs) clear_table( table );
+        else table->flags &= ~TABLE_FLAG_CACHED;
+    }
+}
+
 void free_columns( struct column *columns, UINT num_cols )
 {
     UINT i;
@@ -328,6 +412,9 @@ void free_table( struct table *table )
 {
     if (!table) return;
 
+    /* keep the snapshot of builtin tables around for the next query until it expires */
+    if (!(table->flags & TABLE_FLAG_DYNAMIC) && is_snapshot_valid( table )) return;
+
     clear_table( table );
     if (table->flags & TABLE_FLAG_DYNAMIC)
     {
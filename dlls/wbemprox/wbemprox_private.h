@@ -100,7 +100,9 @@ enum fill_status
     FILL_STATUS_FILTERED
 };
 
-#define TABLE_FLAG_DYNAMIC 0x00000001
+#define TABLE_FLAG_DYNAMIC       0x00000001
+#define TABLE_FLAG_CACHED        0x00000002
+#define TABLE_FLAG_CACHE_TIMEOUT 0x00000004
 
 struct table
 {
@@ -114,6 +116,8 @@ struct table
     UINT flags;
     struct list entry;
     LONG refs;
+    DWORD cache_timeout; /* lifetime of filled rows in milliseconds */
+    DWORD fill_time;
 };
 
 struct property
@@ -184,6 +188,8 @@ BOOL add_table( struct table * ) DECLSPEC_HIDDEN;
 void free_columns( struct column *, UINT ) DECLSPEC_HIDDEN;
 void free_row_values( const struct table *, UINT ) DECLSPEC_HIDDEN;
 void clear_table( struct table * ) DECLSPEC_HIDDEN;
+void fill_table( struct table *, const struct expr * ) DECLSPEC_HIDDEN;
+void invalidate_tables( void ) DECLSPEC_HIDDEN;
 void free_table( struct table * ) DECLSPEC_HIDDEN;
 UINT get_type_size( CIMTYPE ) DECLSPEC_HIDDEN;
 HRESULT eval_cond( const struct table *, UINT, const struct expr *, LONGLONG *, UINT * ) DECLSPEC_HIDDEN;
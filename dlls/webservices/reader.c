@@ -1187,14 +1187,14 @@ static HRESULT parse_qname( const BYTE *str, ULONG len, WS_XML_STRING **prefix_r
     HRESULT hr;
 
     if ((hr = split_qname( str, len, &prefix, &localname )) != S_OK) return hr;
-    if (!(*prefix_ret = alloc_xml_string( NULL, prefix.length ))) return E_OUTOFMEMORY;
+    if (prefix.length) *prefix_ret = dup_xml_string( &prefix, FALSE );
+    else *prefix_ret = alloc_xml_string( NULL, 0 );
+    if (!*prefix_ret) return E_OUTOFMEMORY;
     if (!(*localname_ret = dup_xml_string( &localname, FALSE )))
     {
         free_xml_string( *prefix_ret );
         return E_OUTOFMEMORY;
     }
-    memcpy( (*prefix_ret)->bytes, prefix.bytes, prefix.length );
-    if (prefix.length && add_xml_string( *prefix_ret ) != S_OK) WARN( "prefix not added to dictionary\n" );
     return S_OK;
 }
 
@@ -1424,14 +1424,11 @@ static HRESULT read_string( struct reader *reader, WS_XML_STRING **str )
     ULONG len;
     HRESULT hr;
     if ((hr = read_int31( reader, &len )) != S_OK) return hr;
-    if (!(*str = alloc_xml_string( NULL, len ))) return E_OUTOFMEMORY;
-    if ((hr = read_bytes( reader, (*str)->bytes, len )) == S_OK)
-    {
-        if (add_xml_string( *str ) != S_OK) WARN( "string not added to dictionary\n" );
-        return S_OK;
-    }
-    free_xml_string( *str );
-    return hr;
+    if ((hr = read_more_data( reader, len, NULL, NULL )) != S_OK) return hr;
+    /* names usually repeat, only copy them if they're not in the dictionary yet */
+    if (!(*str = alloc_xml_string( read_current_ptr( reader ), len ))) return E_OUTOFMEMORY;
+    read_skip( reader, len );
+    return S_OK;
 }
 
 static HRESULT read_dict_string( struct reader *reader, WS_XML_STRING **str )
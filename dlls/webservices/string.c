@@ -169,30 +169,16 @@ HRESULT insert_string( struct dictionary *dict, unsigned char *data, ULONG len,
     return S_OK;
 }
 
-HRESULT add_xml_string( WS_XML_STRING *str )
+WS_XML_STRING *alloc_xml_string( const unsigned char *data, ULONG len )
 {
-    HRESULT hr = S_OK;
-    int index;
-    ULONG id;
+    WS_XML_STRING *ret;
 
-    if (str->dictionary) return S_OK;
-    EnterCriticalSection( &dict_cs );
-    if ((index = find_string( &dict_builtin, str->bytes, str->length, &id )) == -1)
-    {
-        heap_free( str->bytes );
-        *str = dict_builtin.dict.strings[id];
-    }
-    else if ((hr = insert_string( &dict_builtin, str->bytes, str->length, index, &id )) == S_OK)
+    if (data)
     {
-        *str = dict_builtin.dict.strings[id];
+        /* strings already in the dictionary are not copied */
+        WS_XML_STRING str = {len, (BYTE *)data};
+        return dup_xml_string( &str, FALSE );
     }
-    LeaveCriticalSection( &dict_cs );
-    return hr;
-}
-
-WS_XML_STRING *alloc_xml_string( const unsigned char *data, ULONG len )
-{
-    WS_XML_STRING *ret;
 
     if (!(ret = heap_alloc_zero( sizeof(*ret) ))) return NULL;
     if ((ret->length = len) && !(ret->bytes = heap_alloc( len )))
@@ -200,11 +186,6 @@ WS_XML_STRING *alloc_xml_string( const unsigned char *data, ULONG len )
         heap_free( ret );
         return NULL;
     }
-    if (data)
-    {
-        memcpy( ret->bytes, data, len );
-        if (add_xml_string( ret ) != S_OK) WARN( "string not added to dictionary\n" );
-    }
     return ret;
 }
 
@@ -97,6 +97,109 @@ static inline float to_sRGB_component(float f)
     return 1.055f * powf(f, 1.0f/2.4f) - 0.055f;
 }
 
+static float srgb_thresholds[256];
+static UINT unpremultiply_factors[256];
+
+static BOOL WINAPI init_conversion_tables(INIT_ONCE *once, void *param, void **context)
+{
+    UINT i, low, high, mid;
+    float f;
+
+    /* srgb_thresholds[i] is the smallest linear value that to_sRGB_byte()
+     * maps to i, found by bisecting the float representation, which has
+     * the same order as the values for positive floats. */
+    srgb_thresholds[0] = 0.0f;
+    for (i = 1; i < 256; i++)
+    {
+        low = 0;
+        high = 0x3f800000; /* 1.0f */
+        while (low < high)
+        {
+            mid = low + (high - low) / 2;
+            memcpy(&f, &mid, sizeof(f));
+            if (floorf(to_sRGB_component(f) * 255.0f + 0.51f) >= i)
+                high = mid;
+            else
+                low = mid + 1;
+        }
+        memcpy(&srgb_thresholds[i], &low, sizeof(float));
+    }
+
+    /* (x * unpremultiply_factors[a]) >> 16 == x * 255 / a for bytes */
+    unpremultiply_factors[0] = 0;
+    for (i = 1; i < 256; i++)
+        unpremultiply_factors[i] = (255 * 65536 + i - 1) / i;
+
+    return TRUE;
+}
+
+static void init_tables(void)
+{
+    static INIT_ONCE init_once = INIT_ONCE_STATIC_INIT;
+    InitOnceExecuteOnce(&init_once, init_conversion_tables, NULL, NULL);
+}
+
+/* same as floorf(to_sRGB_component(f) * 255.0f + 0.51f), clamped to a byte */
+static inline BYTE to_sRGB_byte(float f)
+{
+    UINT low = 0, high = 255, mid;
+
+    while (low < high)
+    {
+        mid = (low + high + 1) / 2;
+        if (srgb_thresholds[mid] <= f) low = mid;
+        else high = mid - 1;
+    }
+    return low;
+}
+
+/* x * alpha / 255 without a division */
+static inline BYTE premultiply_component(BYTE x, BYTE alpha)
+{
+    UINT t = x * alpha;
+    return (t + (t >> 8) + 1) >> 8;
+}
+
+static void premultiply_bits(BYTE *bits, INT width, INT height, UINT stride)
+{
+    INT x, y;
+    BYTE *pixel, alpha;
+
+    for (y = 0; y < height; y++, bits += stride)
+    {
+        for (x = 0, pixel = bits; x < width; x++, pixel += 4)
+        {
+            alpha = pixel[3];
+            if (alpha == 255) continue;
+            pixel[0] = premultiply_component(pixel[0], alpha);
+            pixel[1] = premultiply_component(pixel[1], alpha);
+            pixel[2] = premultiply_component(pixel[2], alpha);
+        }
+    }
+}
+
+static void unpremultiply_bits(BYTE *bits, INT width, INT height, UINT stride)
+{
+    INT x, y;
+    BYTE *pixel, alpha;
+    UINT factor;
+
+    init_tables();
+
+    for (y = 0; y < height; y++, bits += stride)
+    {
+        for (x = 0, pixel = bits; x < width; x++, pixel += 4)
+        {
+            alpha = pixel[3];
+            if (alpha == 0 || alpha == 255) continue;
+            factor = unpremultiply_factors[alpha];
+            pixel[0] = (pixel[0] * factor) >> 16;
+            pixel[1] = (pixel[1] * factor) >> 16;
+            pixel[2] = (pixel[2] * factor) >> 16;
+        }
+    }
+}
+
 #if 0 /* FIXME: enable once needed */
 static void from_sRGB(BYTE *bgr)
 {
@@ -625,7 +728,7 @@ static HRESULT copypixels_to_32bppBGRA(struct FormatConverter *This, const WICRe
             const BYTE *srcrow;
             const BYTE *srcpixel;
             BYTE *dstrow;
-            BYTE *dstpixel;
+            DWORD *dstpixel;
 
             srcstride = 3 * prc->Width;
             srcdatasize = srcstride * prc->Height;
@@ -641,12 +744,10 @@ static HRESULT copypixels_to_32bppBGRA(struct FormatConverter *This, const WICRe
                 dstrow = pbBuffer;
                 for (y=0; y<prc->Height; y++) {
                     srcpixel=srcrow;
-                    dstpixel=dstrow;
+                    dstpixel=(DWORD*)dstrow;
                     for (x=0; x<prc->Width; x++) {
-                        *dstpixel++=*srcpixel++; /* blue */
-                        *dstpixel++=*srcpixel++; /* green */
-                        *dstpixel++=*srcpixel++; /* red */
-                        *dstpixel++=255; /* alpha */
+                        *dstpixel++=0xff000000|srcpixel[2]<<16|srcpixel[1]<<8|srcpixel[0];
+                        srcpixel+=3;
                     }
                     srcrow += srcstride;
                     dstrow += cbStride;
@@ -711,14 +812,15 @@ static HRESULT copypixels_to_32bppBGRA(struct FormatConverter *This, const WICRe
         {
             HRESULT res;
             INT x, y;
+            BYTE *row;
 
             res = IWICBitmapSource_CopyPixels(This->source, prc, cbStride, cbBufferSize, pbBuffer);
             if (FAILED(res)) return res;
 
             /* set all alpha values to 255 */
-            for (y=0; y<prc->Height; y++)
+            for (y=0, row=pbBuffer; y<prc->Height; y++, row+=cbStride)
                 for (x=0; x<prc->Width; x++)
-                    pbBuffer[cbStride*y+4*x+3] = 0xff;
+                    row[4*x+3] = 0xff;
         }
         return S_OK;
     case format_32bppBGRA:
@@ -729,22 +831,11 @@ static HRESULT copypixels_to_32bppBGRA(struct FormatConverter *This, const WICRe
         if (prc)
         {
             HRESULT res;
-            INT x, y;
 
             res = IWICBitmapSource_CopyPixels(This->source, prc, cbStride, cbBufferSize, pbBuffer);
             if (FAILED(res)) return res;
 
-            for (y=0; y<prc->Height; y++)
-                for (x=0; x<prc->Width; x++)
-                {
-                    BYTE alpha = pbBuffer[cbStride*y+4*x+3];
-                    if (alpha != 0 && alpha != 255)
-                    {
-                        pbBuffer[cbStride*y+4*x] = pbBuffer[cbStride*y+4*x] * 255 / alpha;
-                        pbBuffer[cbStride*y+4*x+1] = pbBuffer[cbStride*y+4*x+1] * 255 / alpha;
-                        pbBuffer[cbStride*y+4*x+2] = pbBuffer[cbStride*y+4*x+2] * 255 / alpha;
-                    }
-                }
+            unpremultiply_bits(pbBuffer, prc->Width, prc->Height, cbStride);
         }
         return S_OK;
     case format_48bppRGB:
@@ -892,22 +983,10 @@ static HRESULT copypixels_to_32bppRGBA(struct FormatConverter *This, const WICRe
     case format_32bppPRGBA:
         if (prc)
         {
-            INT x, y;
-
             hr = IWICBitmapSource_CopyPixels(This->source, prc, cbStride, cbBufferSize, pbBuffer);
             if (FAILED(hr)) return hr;
 
-            for (y=0; y<prc->Height; y++)
-                for (x=0; x<prc->Width; x++)
-                {
-                    BYTE alpha = pbBuffer[cbStride*y+4*x+3];
-                    if (alpha != 0 && alpha != 255)
-                    {
-                        pbBuffer[cbStride*y+4*x] = pbBuffer[cbStride*y+4*x] * 255 / alpha;
-                        pbBuffer[cbStride*y+4*x+1] = pbBuffer[cbStride*y+4*x+1] * 255 / alpha;
-                        pbBuffer[cbStride*y+4*x+2] = pbBuffer[cbStride*y+4*x+2] * 255 / alpha;
-                    }
-                }
+            unpremultiply_bits(pbBuffer, prc->Width, prc->Height, cbStride);
         }
         return S_OK;
 
@@ -965,21 +1044,7 @@ static HRESULT copypixels_to_32bppPBGRA(struct FormatConverter *This, const WICR
     default:
         hr = copypixels_to_32bppBGRA(This, prc, cbStride, cbBufferSize, pbBuffer, source_format);
         if (SUCCEEDED(hr) && prc)
-        {
-            INT x, y;
-
-            for (y=0; y<prc->Height; y++)
-                for (x=0; x<prc->Width; x++)
-                {
-                    BYTE alpha = pbBuffer[cbStride*y+4*x+3];
-                    if (alpha != 255)
-                    {
-                        pbBuffer[cbStride*y+4*x] = pbBuffer[cbStride*y+4*x] * alpha / 255;
-                        pbBuffer[cbStride*y+4*x+1] = pbBuffer[cbStride*y+4*x+1] * alpha / 255;
-                        pbBuffer[cbStride*y+4*x+2] = pbBuffer[cbStride*y+4*x+2] * alpha / 255;
-                    }
-                }
-        }
+            premultiply_bits(pbBuffer, prc->Width, prc->Height, cbStride);
         return hr;
     }
 }
@@ -998,21 +1063,7 @@ static HRESULT copypixels_to_32bppPRGBA(struct FormatConverter *This, const WICR
     default:
         hr = copypixels_to_32bppRGBA(This, prc, cbStride, cbBufferSize, pbBuffer, source_format);
         if (SUCCEEDED(hr) && prc)
-        {
-            INT x, y;
-
-            for (y=0; y<prc->Height; y++)
-                for (x=0; x<prc->Width; x++)
-                {
-                    BYTE alpha = pbBuffer[cbStride*y+4*x+3];
-                    if (alpha != 255)
-                    {
-                        pbBuffer[cbStride*y+4*x] = pbBuffer[cbStride*y+4*x] * alpha / 255;
-                        pbBuffer[cbStride*y+4*x+1] = pbBuffer[cbStride*y+4*x+1] * alpha / 255;
-                        pbBuffer[cbStride*y+4*x+2] = pbBuffer[cbStride*y+4*x+2] * alpha / 255;
-                    }
-                }
-        }
+            premultiply_bits(pbBuffer, prc->Width, prc->Height, cbStride);
         return hr;
     }
 }
@@ -1099,6 +1150,8 @@ static HRESULT copypixels_to_24bppBGR(struct FormatConverter *This, const WICRec
                 INT x, y;
                 BYTE *src = srcdata, *dst = pbBuffer;
 
+                init_tables();
+
                 for (y = 0; y < prc->Height; y++)
                 {
                     float *gray_float = (float *)src;
@@ -1106,7 +1159,7 @@ static HRESULT copypixels_to_24bppBGR(struct FormatConverter *This, const WICRec
 
                     for (x = 0; x < prc->Width; x++)
                     {
-                        BYTE gray = (BYTE)floorf(to_sRGB_component(gray_float[x]) * 255.0f + 0.51f);
+                        BYTE gray = to_sRGB_byte(gray_float[x]);
                         *bgr++ = gray;
                         *bgr++ = gray;
                         *bgr++ = gray;
@@ -1319,13 +1372,15 @@ static HRESULT copypixels_to_8bppGray(struct FormatConverter *This, const WICRec
                 INT x, y;
                 BYTE *src = srcdata, *dst = pbBuffer;
 
+                init_tables();
+
                 for (y=0; y < prc->Height; y++)
                 {
                     float *srcpixel = (float*)src;
                     BYTE *dstpixel = dst;
 
                     for (x=0; x < prc->Width; x++)
-                        *dstpixel++ = (BYTE)floorf(to_sRGB_component(*srcpixel++) * 255.0f + 0.51f);
+                        *dstpixel++ = to_sRGB_byte(*srcpixel++);
 
                     src += srcstride;
                     dst += cbStride;
@@ -1353,6 +1408,8 @@ static HRESULT copypixels_to_8bppGray(struct FormatConverter *This, const WICRec
         INT x, y;
         BYTE *src = srcdata, *dst = pbBuffer;
 
+        init_tables();
+
         for (y = 0; y < prc->Height; y++)
         {
             BYTE *bgr = src;
@@ -1361,8 +1418,7 @@ static HRESULT copypixels_to_8bppGray(struct FormatConverter *This, const WICRec
             {
                 float gray = (bgr[2] * 0.2126f + bgr[1] * 0.7152f + bgr[0] * 0.0722f) / 255.0f;
 
-                gray = to_sRGB_component(gray) * 255.0f;
-                dst[x] = (BYTE)floorf(gray + 0.51f);
+                dst[x] = to_sRGB_byte(gray);
                 bgr += 3;
             }
             src += srcstride;
@@ -69,6 +69,7 @@ static const WCHAR wszJpegYCrCbSubsampling[] = {'J','p','e','g','Y','C','r','C',
 static const WCHAR wszSuppressApp0[] = {'S','u','p','p','r','e','s','s','A','p','p','0',0};
 
 #define MAKE_FUNCPTR(f) static typeof(f) * p##f
+MAKE_FUNCPTR(jpeg_abort_decompress);
 MAKE_FUNCPTR(jpeg_CreateCompress);
 MAKE_FUNCPTR(jpeg_CreateDecompress);
 MAKE_FUNCPTR(jpeg_destroy_compress);
@@ -94,6 +95,7 @@ static void *load_libjpeg(void)
         return NULL; \
     }
 
+        LOAD_FUNCPTR(jpeg_abort_decompress);
         LOAD_FUNCPTR(jpeg_CreateCompress);
         LOAD_FUNCPTR(jpeg_CreateDecompress);
         LOAD_FUNCPTR(jpeg_destroy_compress);
@@ -156,11 +158,19 @@ typedef struct {
     struct jpeg_error_mgr jerr;
     struct jpeg_source_mgr source_mgr;
     BYTE source_buffer[1024];
+    ULARGE_INTEGER source_pos;
     UINT bpp, stride;
-    BYTE *image_data;
+    BYTE *image_data; /* rows cache_first up to cinfo.output_scanline */
+    UINT cache_first, window_rows;
+    BOOL decode_failed;
     CRITICAL_SECTION lock;
 } JpegDecoder;
 
+/* images whose decoded size is larger than this are decoded on demand,
+ * keeping a window of the most recently decoded rows */
+#define MAX_PRELOAD_SIZE (64 * 1024 * 1024)
+#define DECODE_WINDOW_SIZE (4 * 1024 * 1024)
+
 static inline JpegDecoder *impl_from_IWICBitmapDecoder(IWICBitmapDecoder *iface)
 {
     return CONTAINING_RECORD(iface, JpegDecoder, IWICBitmapDecoder_iface);
@@ -259,10 +269,15 @@ static void source_mgr_init_source(j_decompress_ptr cinfo)
 static jpeg_boolean source_mgr_fill_input_buffer(j_decompress_ptr cinfo)
 {
     JpegDecoder *This = decoder_from_decompress(cinfo);
+    LARGE_INTEGER seek;
     HRESULT hr;
     ULONG bytesread;
 
-    hr = IStream_Read(This->stream, This->source_buffer, 1024, &bytesread);
+    /* the stream may have been moved since the last read */
+    seek.QuadPart = This->source_pos.QuadPart;
+    hr = IStream_Seek(This->stream, seek, STREAM_SEEK_SET, NULL);
+    if (SUCCEEDED(hr))
+        hr = IStream_Read(This->stream, This->source_buffer, 1024, &bytesread);
 
     if (FAILED(hr) || bytesread == 0)
     {
@@ -272,6 +287,7 @@ static jpeg_boolean source_mgr_fill_input_buffer(j_decompress_ptr cinfo)
     {
         This->source_mgr.next_input_byte = This->source_buffer;
         This->source_mgr.bytes_in_buffer = bytesread;
+        This->source_pos.QuadPart += bytesread;
         return TRUE;
     }
 }
@@ -279,12 +295,10 @@ static jpeg_boolean source_mgr_fill_input_buffer(j_decompress_ptr cinfo)
 static void source_mgr_skip_input_data(j_decompress_ptr cinfo, long num_bytes)
 {
     JpegDecoder *This = decoder_from_decompress(cinfo);
-    LARGE_INTEGER seek;
 
     if (num_bytes > This->source_mgr.bytes_in_buffer)
     {
-        seek.QuadPart = num_bytes - This->source_mgr.bytes_in_buffer;
-        IStream_Seek(This->stream, seek, STREAM_SEEK_CUR, NULL);
+        This->source_pos.QuadPart += num_bytes - This->source_mgr.bytes_in_buffer;
         This->source_mgr.bytes_in_buffer = 0;
     }
     else if (num_bytes > 0)
@@ -298,14 +312,147 @@ static void source_mgr_term_source(j_decompress_ptr cinfo)
 {
 }
 
+static BOOL set_out_color_space(JpegDecoder *This)
+{
+    switch (This->cinfo.jpeg_color_space)
+    {
+    case JCS_GRAYSCALE:
+        This->cinfo.out_color_space = JCS_GRAYSCALE;
+        return TRUE;
+    case JCS_RGB:
+    case JCS_YCbCr:
+        This->cinfo.out_color_space = JCS_RGB;
+        return TRUE;
+    case JCS_CMYK:
+    case JCS_YCCK:
+        This->cinfo.out_color_space = JCS_CMYK;
+        return TRUE;
+    default:
+        ERR("Unknown JPEG color space %i\n", This->cinfo.jpeg_color_space);
+        return FALSE;
+    }
+}
+
+/* starts decoding from the first row again, must be called with error
+ * handling set up */
+static BOOL restart_decompress(JpegDecoder *This)
+{
+    pjpeg_abort_decompress(&This->cinfo);
+
+    This->source_pos.QuadPart = 0;
+    This->source_mgr.bytes_in_buffer = 0;
+    This->cache_first = 0;
+
+    if (pjpeg_read_header(&This->cinfo, TRUE) != JPEG_HEADER_OK)
+        return FALSE;
+    if (!set_out_color_space(This))
+        return FALSE;
+    return pjpeg_start_decompress(&This->cinfo);
+}
+
+/* Makes rows first to last - 1 available in image_data, decoding them if
+ * needed. When decoding on demand, last - first must not be larger than
+ * half the window; the window only slides forward once it is full, so
+ * the rows of overlapping requests are kept. The decoder can only move
+ * forward, so rows before the window require a restart. */
+static HRESULT decode_rows(JpegDecoder *This, UINT first, UINT last)
+{
+    jmp_buf jmpbuf;
+    JSAMPROW out_rows[4];
+    JDIMENSION ret;
+    BYTE *rows;
+    UINT max_rows, i, window_first;
+
+    if (!This->decode_failed && first >= This->cache_first && last <= This->cinfo.output_scanline)
+        return S_OK;
+
+    This->cinfo.client_data = jmpbuf;
+
+    if (setjmp(jmpbuf))
+    {
+        This->decode_failed = TRUE;
+        return E_FAIL;
+    }
+
+    if (!This->image_data &&
+        !(This->image_data = heap_alloc(This->window_rows * This->stride)))
+        return E_OUTOFMEMORY;
+
+    if (This->decode_failed || first < This->cache_first)
+    {
+        This->decode_failed = TRUE;
+        if (!restart_decompress(This))
+        {
+            ERR("failed to restart decompression\n");
+            return E_FAIL;
+        }
+    }
+    This->decode_failed = TRUE;
+
+    window_first = This->cache_first;
+    if (last - window_first > This->window_rows)
+        window_first = last - This->window_rows / 2;
+
+    if (window_first >= This->cinfo.output_scanline)
+    {
+        /* decode and drop the rows before the window */
+        out_rows[0] = This->image_data;
+        while (This->cinfo.output_scanline < window_first)
+        {
+            if (!pjpeg_read_scanlines(&This->cinfo, out_rows, 1))
+            {
+                ERR("read_scanlines failed\n");
+                return E_FAIL;
+            }
+        }
+    }
+    else if (window_first > This->cache_first)
+    {
+        /* keep the rows that were already decoded */
+        memmove(This->image_data, This->image_data + (window_first - This->cache_first) * This->stride,
+                (This->cinfo.output_scanline - window_first) * This->stride);
+    }
+    This->cache_first = window_first;
+
+    while (This->cinfo.output_scanline < last)
+    {
+        rows = This->image_data + This->stride * (This->cinfo.output_scanline - window_first);
+        max_rows = min(last - This->cinfo.output_scanline, 4);
+        for (i=0; i<max_rows; i++)
+            out_rows[i] = rows + This->stride * i;
+
+        ret = pjpeg_read_scanlines(&This->cinfo, out_rows, max_rows);
+        if (ret == 0)
+        {
+            ERR("read_scanlines failed\n");
+            return E_FAIL;
+        }
+
+        if (This->bpp == 24)
+        {
+            /* libjpeg gives us RGB data and we want BGR, so byteswap the data */
+            reverse_bgr8(3, rows, This->cinfo.output_width, ret, This->stride);
+        }
+
+        if (This->cinfo.out_color_space == JCS_CMYK && This->cinfo.saw_Adobe_marker)
+        {
+            /* Adobe JPEG's have inverted CMYK data. */
+            for (i=0; i<ret * This->stride; i++)
+                rows[i] ^= 0xff;
+        }
+    }
+
+    This->decode_failed = FALSE;
+    return S_OK;
+}
+
 static HRESULT WINAPI JpegDecoder_Initialize(IWICBitmapDecoder *iface, IStream *pIStream,
     WICDecodeOptions cacheOptions)
 {
     JpegDecoder *This = impl_from_IWICBitmapDecoder(iface);
     int ret;
-    LARGE_INTEGER seek;
     jmp_buf jmpbuf;
-    UINT data_size, i;
+    HRESULT hr;
 
     TRACE("(%p,%p,%u)\n", iface, pIStream, cacheOptions);
 
@@ -339,9 +486,7 @@ static HRESULT WINAPI JpegDecoder_Initialize(IWICBitmapDecoder *iface, IStream *
     This->stream = pIStream;
     IStream_AddRef(pIStream);
 
-    seek.QuadPart = 0;
-    IStream_Seek(This->stream, seek, STREAM_SEEK_SET, NULL);
-
+    This->source_pos.QuadPart = 0;
     This->source_mgr.bytes_in_buffer = 0;
     This->source_mgr.init_source = source_mgr_init_source;
     This->source_mgr.fill_input_buffer = source_mgr_fill_input_buffer;
@@ -359,21 +504,8 @@ static HRESULT WINAPI JpegDecoder_Initialize(IWICBitmapDecoder *iface, IStream *
         return E_FAIL;
     }
 
-    switch (This->cinfo.jpeg_color_space)
+    if (!set_out_color_space(This))
     {
-    case JCS_GRAYSCALE:
-        This->cinfo.out_color_space = JCS_GRAYSCALE;
-        break;
-    case JCS_RGB:
-    case JCS_YCbCr:
-        This->cinfo.out_color_space = JCS_RGB;
-        break;
-    case JCS_CMYK:
-    case JCS_YCCK:
-        This->cinfo.out_color_space = JCS_CMYK;
-        break;
-    default:
-        ERR("Unknown JPEG color space %i\n", This->cinfo.jpeg_color_space);
         LeaveCriticalSection(&This->lock);
         return E_FAIL;
     }
@@ -390,48 +522,21 @@ static HRESULT WINAPI JpegDecoder_Initialize(IWICBitmapDecoder *iface, IStream *
     else This->bpp = 24;
 
     This->stride = (This->bpp * This->cinfo.output_width + 7) / 8;
-    data_size = This->stride * This->cinfo.output_height;
-
-    This->image_data = heap_alloc(data_size);
-    if (!This->image_data)
-    {
-        LeaveCriticalSection(&This->lock);
-        return E_OUTOFMEMORY;
-    }
 
-    while (This->cinfo.output_scanline < This->cinfo.output_height)
+    if ((ULONGLONG)This->stride * This->cinfo.output_height <= MAX_PRELOAD_SIZE)
     {
-        UINT first_scanline = This->cinfo.output_scanline;
-        UINT max_rows;
-        JSAMPROW out_rows[4];
-        JDIMENSION ret;
-
-        max_rows = min(This->cinfo.output_height-first_scanline, 4);
-        for (i=0; i<max_rows; i++)
-            out_rows[i] = This->image_data + This->stride * (first_scanline+i);
-
-        ret = pjpeg_read_scanlines(&This->cinfo, out_rows, max_rows);
-        if (ret == 0)
+        This->window_rows = This->cinfo.output_height;
+        hr = decode_rows(This, 0, This->cinfo.output_height);
+        if (FAILED(hr))
         {
-            ERR("read_scanlines failed\n");
             LeaveCriticalSection(&This->lock);
-            return E_FAIL;
+            return hr;
         }
     }
-
-    if (This->bpp == 24)
-    {
-        /* libjpeg gives us RGB data and we want BGR, so byteswap the data */
-        reverse_bgr8(3, This->image_data,
-            This->cinfo.output_width, This->cinfo.output_height,
-            This->stride);
-    }
-
-    if (This->cinfo.out_color_space == JCS_CMYK && This->cinfo.saw_Adobe_marker)
+    else
     {
-        /* Adobe JPEG's have inverted CMYK data. */
-        for (i=0; i<data_size; i++)
-            This->image_data[i] ^= 0xff;
+        TRACE("decoding %ux%u image on demand\n", This->cinfo.output_width, This->cinfo.output_height);
+        This->window_rows = max(DECODE_WINDOW_SIZE / This->stride, 2);
     }
 
     This->initialized = TRUE;
@@ -643,12 +748,66 @@ static HRESULT WINAPI JpegDecoder_Frame_CopyPixels(IWICBitmapFrameDecode *iface,
     const WICRect *prc, UINT cbStride, UINT cbBufferSize, BYTE *pbBuffer)
 {
     JpegDecoder *This = impl_from_IWICBitmapFrameDecode(iface);
+    WICRect rect, chunk_rect;
+    UINT bytesperrow, chunk, y;
+    HRESULT hr;
 
     TRACE("(%p,%s,%u,%u,%p)\n", iface, debug_wic_rect(prc), cbStride, cbBufferSize, pbBuffer);
 
-    return copy_pixels(This->bpp, This->image_data,
-        This->cinfo.output_width, This->cinfo.output_height, This->stride,
-        prc, cbStride, cbBufferSize, pbBuffer);
+    if (!prc)
+    {
+        rect.X = 0;
+        rect.Y = 0;
+        rect.Width = This->cinfo.output_width;
+        rect.Height = This->cinfo.output_height;
+    }
+    else
+    {
+        if (prc->X < 0 || prc->Y < 0 || prc->X+prc->Width > This->cinfo.output_width ||
+            prc->Y+prc->Height > This->cinfo.output_height)
+            return E_INVALIDARG;
+        rect = *prc;
+    }
+
+    EnterCriticalSection(&This->lock);
+
+    if (rect.Height <= 0)
+    {
+        hr = copy_pixels(This->bpp, This->image_data,
+            This->cinfo.output_width, This->cinfo.output_height, This->stride,
+            &rect, cbStride, cbBufferSize, pbBuffer);
+        goto end;
+    }
+
+    /* check the whole buffer first, it is filled in pieces */
+    bytesperrow = (This->bpp * rect.Width + 7) / 8;
+    if (cbStride < bytesperrow || (ULONGLONG)cbStride * (rect.Height - 1) + bytesperrow > cbBufferSize)
+    {
+        hr = E_INVALIDARG;
+        goto end;
+    }
+
+    /* large images are copied in pieces that fit in the decoding window */
+    chunk = This->window_rows >= This->cinfo.output_height ? This->cinfo.output_height : This->window_rows / 2;
+    for (y = 0; y < rect.Height; y += chunk_rect.Height)
+    {
+        chunk_rect = rect;
+        chunk_rect.Y = rect.Y + y;
+        chunk_rect.Height = min(rect.Height - y, chunk);
+        hr = decode_rows(This, chunk_rect.Y, chunk_rect.Y + chunk_rect.Height);
+        if (FAILED(hr)) break;
+
+        chunk_rect.Y -= This->cache_first;
+        hr = copy_pixels(This->bpp, This->image_data,
+            This->cinfo.output_width, This->cinfo.output_scanline - This->cache_first, This->stride,
+            &chunk_rect, cbStride, cbBufferSize - cbStride * y, pbBuffer + cbStride * y);
+        if (FAILED(hr)) break;
+    }
+
+end:
+    LeaveCriticalSection(&This->lock);
+
+    return hr;
 }
 
 static HRESULT WINAPI JpegDecoder_Frame_GetMetadataQueryReader(IWICBitmapFrameDecode *iface,
@@ -785,6 +944,8 @@ HRESULT JpegDecoder_CreateInstance(REFIID iid, void** ppv)
     This->cinfo_initialized = FALSE;
     This->stream = NULL;
     This->image_data = NULL;
+    This->cache_first = This->window_rows = 0;
+    This->decode_failed = FALSE;
     InitializeCriticalSection(&This->lock);
     This->lock.DebugInfo->Spare[0] = (DWORD_PTR)(__FILE__ ": JpegDecoder.lock");
 
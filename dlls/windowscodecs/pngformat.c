@@ -311,6 +311,7 @@ MAKE_FUNCPTR(png_get_bit_depth);
 MAKE_FUNCPTR(png_get_color_type);
 MAKE_FUNCPTR(png_get_error_ptr);
 MAKE_FUNCPTR(png_get_iCCP);
+MAKE_FUNCPTR(png_get_interlace_type);
 MAKE_FUNCPTR(png_get_image_height);
 MAKE_FUNCPTR(png_get_image_width);
 MAKE_FUNCPTR(png_get_io_ptr);
@@ -335,6 +336,8 @@ MAKE_FUNCPTR(png_set_write_fn);
 MAKE_FUNCPTR(png_read_end);
 MAKE_FUNCPTR(png_read_image);
 MAKE_FUNCPTR(png_read_info);
+MAKE_FUNCPTR(png_read_row);
+MAKE_FUNCPTR(png_start_read_image);
 MAKE_FUNCPTR(png_write_end);
 MAKE_FUNCPTR(png_write_info);
 MAKE_FUNCPTR(png_write_rows);
@@ -377,6 +380,7 @@ static void *load_libpng(void)
         LOAD_FUNCPTR(png_get_color_type);
         LOAD_FUNCPTR(png_get_error_ptr);
         LOAD_FUNCPTR(png_get_iCCP);
+        LOAD_FUNCPTR(png_get_interlace_type);
         LOAD_FUNCPTR(png_get_image_height);
         LOAD_FUNCPTR(png_get_image_width);
         LOAD_FUNCPTR(png_get_io_ptr);
@@ -401,6 +405,8 @@ static void *load_libpng(void)
         LOAD_FUNCPTR(png_read_end);
         LOAD_FUNCPTR(png_read_image);
         LOAD_FUNCPTR(png_read_info);
+        LOAD_FUNCPTR(png_read_row);
+        LOAD_FUNCPTR(png_start_read_image);
         LOAD_FUNCPTR(png_write_end);
         LOAD_FUNCPTR(png_write_info);
         LOAD_FUNCPTR(png_write_rows);
@@ -451,12 +457,20 @@ typedef struct {
     int width, height;
     UINT stride;
     const WICPixelFormatGUID *format;
-    BYTE *image_bits;
+    BYTE *image_bits; /* rows cache_first up to next_row */
+    UINT cache_first, window_rows, next_row;
+    BOOL decode_failed;
+    ULARGE_INTEGER read_pos;
     CRITICAL_SECTION lock; /* must be held when png structures are accessed or initialized is set */
     ULONG metadata_count;
     metadata_block_info* metadata_blocks;
 } PngDecoder;
 
+/* non-interlaced images whose decoded size is larger than this are decoded
+ * on demand, keeping a window of the most recently decoded rows */
+#define MAX_PRELOAD_SIZE (64 * 1024 * 1024)
+#define DECODE_WINDOW_SIZE (4 * 1024 * 1024)
+
 static inline PngDecoder *impl_from_IWICBitmapDecoder(IWICBitmapDecoder *iface)
 {
     return CONTAINING_RECORD(iface, PngDecoder, IWICBitmapDecoder_iface);
@@ -555,56 +569,44 @@ static HRESULT WINAPI PngDecoder_QueryCapability(IWICBitmapDecoder *iface, IStre
 
 static void user_read_data(png_structp png_ptr, png_bytep data, png_size_t length)
 {
-    IStream *stream = ppng_get_io_ptr(png_ptr);
+    PngDecoder *This = ppng_get_io_ptr(png_ptr);
+    LARGE_INTEGER seek;
     HRESULT hr;
     ULONG bytesread;
 
-    hr = IStream_Read(stream, data, length, &bytesread);
+    /* metadata readers share the stream, so don't rely on its position */
+    seek.QuadPart = This->read_pos.QuadPart;
+    hr = IStream_Seek(This->stream, seek, STREAM_SEEK_SET, NULL);
+    if (SUCCEEDED(hr))
+        hr = IStream_Read(This->stream, data, length, &bytesread);
     if (FAILED(hr) || bytesread != length)
     {
         ppng_error(png_ptr, "failed reading data");
     }
+    This->read_pos.QuadPart += bytesread;
 }
 
-static HRESULT WINAPI PngDecoder_Initialize(IWICBitmapDecoder *iface, IStream *pIStream,
-    WICDecodeOptions cacheOptions)
+/* Creates the libpng reader, reads the header and sets up the transforms
+ * for the pixel format. libpng errors jump to jmpbuf. */
+static HRESULT create_png_reader(PngDecoder *This, jmp_buf jmpbuf)
 {
-    PngDecoder *This = impl_from_IWICBitmapDecoder(iface);
-    LARGE_INTEGER seek;
-    HRESULT hr=S_OK;
-    png_bytep *row_pointers=NULL;
-    UINT image_size;
-    UINT i;
     int color_type, bit_depth;
     png_bytep trans;
     int num_trans;
     png_uint_32 transparency;
     png_color_16p trans_values;
-    jmp_buf jmpbuf;
-    BYTE chunk_type[4];
-    ULONG chunk_size;
-    ULARGE_INTEGER chunk_start;
-    ULONG metadata_blocks_size = 0;
-
-    TRACE("(%p,%p,%x)\n", iface, pIStream, cacheOptions);
-
-    EnterCriticalSection(&This->lock);
 
     /* initialize libpng */
     This->png_ptr = ppng_create_read_struct(PNG_LIBPNG_VER_STRING, NULL, NULL, NULL);
     if (!This->png_ptr)
-    {
-        hr = E_FAIL;
-        goto end;
-    }
+        return E_FAIL;
 
     This->info_ptr = ppng_create_info_struct(This->png_ptr);
     if (!This->info_ptr)
     {
         ppng_destroy_read_struct(&This->png_ptr, NULL, NULL);
         This->png_ptr = NULL;
-        hr = E_FAIL;
-        goto end;
+        return E_FAIL;
     }
 
     This->end_info = ppng_create_info_struct(This->png_ptr);
@@ -612,28 +614,15 @@ static HRESULT WINAPI PngDecoder_Initialize(IWICBitmapDecoder *iface, IStream *p
     {
         ppng_destroy_read_struct(&This->png_ptr, &This->info_ptr, NULL);
         This->png_ptr = NULL;
-        hr = E_FAIL;
-        goto end;
+        return E_FAIL;
     }
 
-    /* set up setjmp/longjmp error handling */
-    if (setjmp(jmpbuf))
-    {
-        ppng_destroy_read_struct(&This->png_ptr, &This->info_ptr, &This->end_info);
-        This->png_ptr = NULL;
-        hr = WINCODEC_ERR_UNKNOWNIMAGEFORMAT;
-        goto end;
-    }
     ppng_set_error_fn(This->png_ptr, jmpbuf, user_error_fn, user_warning_fn);
     ppng_set_crc_action(This->png_ptr, PNG_CRC_QUIET_USE, PNG_CRC_QUIET_USE);
 
-    /* seek to the start of the stream */
-    seek.QuadPart = 0;
-    hr = IStream_Seek(pIStream, seek, STREAM_SEEK_SET, NULL);
-    if (FAILED(hr)) goto end;
-
-    /* set up custom i/o handling */
-    ppng_set_read_fn(This->png_ptr, pIStream, user_read_data);
+    /* set up custom i/o handling, starting at the beginning of the stream */
+    This->read_pos.QuadPart = 0;
+    ppng_set_read_fn(This->png_ptr, This, user_read_data);
 
     /* read the header */
     ppng_read_info(This->png_ptr, This->info_ptr);
@@ -672,8 +661,7 @@ static HRESULT WINAPI PngDecoder_Initialize(IWICBitmapDecoder *iface, IStream *p
         case 16: This->format = &GUID_WICPixelFormat64bppRGBA; break;
         default:
             ERR("invalid RGBA bit depth: %i\n", bit_depth);
-            hr = E_FAIL;
-            goto end;
+            return E_FAIL;
         }
         break;
     case PNG_COLOR_TYPE_GRAY:
@@ -689,8 +677,7 @@ static HRESULT WINAPI PngDecoder_Initialize(IWICBitmapDecoder *iface, IStream *p
             case 16: This->format = &GUID_WICPixelFormat16bppGray; break;
             default:
                 ERR("invalid grayscale bit depth: %i\n", bit_depth);
-                hr = E_FAIL;
-                goto end;
+                return E_FAIL;
             }
             break;
         }
@@ -705,8 +692,7 @@ static HRESULT WINAPI PngDecoder_Initialize(IWICBitmapDecoder *iface, IStream *p
         case 8: This->format = &GUID_WICPixelFormat8bppIndexed; break;
         default:
             ERR("invalid indexed color bit depth: %i\n", bit_depth);
-            hr = E_FAIL;
-            goto end;
+            return E_FAIL;
         }
         break;
     case PNG_COLOR_TYPE_RGB:
@@ -720,45 +706,167 @@ static HRESULT WINAPI PngDecoder_Initialize(IWICBitmapDecoder *iface, IStream *p
         case 16: This->format = &GUID_WICPixelFormat48bppRGB; break;
         default:
             ERR("invalid RGB color bit depth: %i\n", bit_depth);
-            hr = E_FAIL;
-            goto end;
+            return E_FAIL;
         }
         break;
     default:
         ERR("invalid color type %i\n", color_type);
-        hr = E_FAIL;
+        return E_FAIL;
+    }
+
+    return S_OK;
+}
+
+/* starts reading from the first row again, libpng errors jump to jmpbuf */
+static HRESULT restart_png_reader(PngDecoder *This, jmp_buf jmpbuf)
+{
+    HRESULT hr;
+
+    ppng_destroy_read_struct(&This->png_ptr, &This->info_ptr, &This->end_info);
+    This->png_ptr = NULL;
+    This->cache_first = This->next_row = 0;
+
+    hr = create_png_reader(This, jmpbuf);
+    if (SUCCEEDED(hr))
+        ppng_start_read_image(This->png_ptr);
+    return hr;
+}
+
+/* Makes rows first to last - 1 available in image_bits, decoding them if
+ * needed. When decoding on demand, last - first must not be larger than
+ * half the window; the window only slides forward once it is full, so
+ * the rows of overlapping requests are kept. libpng can only move forward,
+ * so rows before the window require a restart. */
+static HRESULT decode_rows(PngDecoder *This, UINT first, UINT last)
+{
+    jmp_buf jmpbuf;
+    UINT window_first;
+
+    if (!This->decode_failed && first >= This->cache_first && last <= This->next_row)
+        return S_OK;
+
+    if (!This->image_bits &&
+        !(This->image_bits = HeapAlloc(GetProcessHeap(), 0, This->window_rows * This->stride)))
+        return E_OUTOFMEMORY;
+
+    if (setjmp(jmpbuf))
+    {
+        This->decode_failed = TRUE;
+        return E_FAIL;
+    }
+
+    if (This->decode_failed || first < This->cache_first)
+    {
+        This->decode_failed = TRUE;
+        if (FAILED(restart_png_reader(This, jmpbuf)))
+            return E_FAIL;
+    }
+    else
+        ppng_set_error_fn(This->png_ptr, jmpbuf, user_error_fn, user_warning_fn);
+    This->decode_failed = TRUE;
+
+    window_first = This->cache_first;
+    if (last - window_first > This->window_rows)
+        window_first = last - This->window_rows / 2;
+
+    if (window_first >= This->next_row)
+    {
+        /* decode and drop the rows before the window */
+        for (; This->next_row < window_first; This->next_row++)
+            ppng_read_row(This->png_ptr, This->image_bits, NULL);
+    }
+    else if (window_first > This->cache_first)
+    {
+        /* keep the rows that were already decoded */
+        memmove(This->image_bits, This->image_bits + (window_first - This->cache_first) * This->stride,
+                (This->next_row - window_first) * This->stride);
+    }
+    This->cache_first = window_first;
+
+    for (; This->next_row < last; This->next_row++)
+        ppng_read_row(This->png_ptr, This->image_bits + (This->next_row - window_first) * This->stride, NULL);
+
+    This->decode_failed = FALSE;
+    return S_OK;
+}
+
+static HRESULT WINAPI PngDecoder_Initialize(IWICBitmapDecoder *iface, IStream *pIStream,
+    WICDecodeOptions cacheOptions)
+{
+    PngDecoder *This = impl_from_IWICBitmapDecoder(iface);
+    LARGE_INTEGER seek;
+    HRESULT hr=S_OK;
+    png_bytep *row_pointers=NULL;
+    UINT image_size;
+    UINT i;
+    jmp_buf jmpbuf;
+    BYTE chunk_type[4];
+    ULONG chunk_size;
+    ULARGE_INTEGER chunk_start;
+    ULONG metadata_blocks_size = 0;
+
+    TRACE("(%p,%p,%x)\n", iface, pIStream, cacheOptions);
+
+    EnterCriticalSection(&This->lock);
+
+    IStream_AddRef(pIStream);
+    if (This->stream) IStream_Release(This->stream);
+    This->stream = pIStream;
+
+    /* set up setjmp/longjmp error handling */
+    if (setjmp(jmpbuf))
+    {
+        ppng_destroy_read_struct(&This->png_ptr, &This->info_ptr, &This->end_info);
+        This->png_ptr = NULL;
+        hr = WINCODEC_ERR_UNKNOWNIMAGEFORMAT;
         goto end;
     }
 
+    hr = create_png_reader(This, jmpbuf);
+    if (FAILED(hr)) goto end;
+
     /* read the image data */
     This->width = ppng_get_image_width(This->png_ptr, This->info_ptr);
     This->height = ppng_get_image_height(This->png_ptr, This->info_ptr);
     This->stride = (This->width * This->bpp + 7) / 8;
-    image_size = This->stride * This->height;
 
-    This->image_bits = HeapAlloc(GetProcessHeap(), 0, image_size);
-    if (!This->image_bits)
+    if (ppng_get_interlace_type(This->png_ptr, This->info_ptr) == PNG_INTERLACE_NONE &&
+        (ULONGLONG)This->stride * This->height > MAX_PRELOAD_SIZE)
     {
-        hr = E_OUTOFMEMORY;
-        goto end;
+        TRACE("decoding %ux%u image on demand\n", This->width, This->height);
+        This->window_rows = max(DECODE_WINDOW_SIZE / This->stride, 2);
+        ppng_start_read_image(This->png_ptr);
     }
-
-    row_pointers = HeapAlloc(GetProcessHeap(), 0, sizeof(png_bytep)*This->height);
-    if (!row_pointers)
+    else
     {
-        hr = E_OUTOFMEMORY;
-        goto end;
-    }
+        image_size = This->stride * This->height;
 
-    for (i=0; i<This->height; i++)
-        row_pointers[i] = This->image_bits + i * This->stride;
+        This->image_bits = HeapAlloc(GetProcessHeap(), 0, image_size);
+        if (!This->image_bits)
+        {
+            hr = E_OUTOFMEMORY;
+            goto end;
+        }
 
-    ppng_read_image(This->png_ptr, row_pointers);
+        row_pointers = HeapAlloc(GetProcessHeap(), 0, sizeof(png_bytep)*This->height);
+        if (!row_pointers)
+        {
+            hr = E_OUTOFMEMORY;
+            goto end;
+        }
 
-    HeapFree(GetProcessHeap(), 0, row_pointers);
-    row_pointers = NULL;
+        for (i=0; i<This->height; i++)
+            row_pointers[i] = This->image_bits + i * This->stride;
+
+        ppng_read_image(This->png_ptr, row_pointers);
 
-    ppng_read_end(This->png_ptr, This->end_info);
+        HeapFree(GetProcessHeap(), 0, row_pointers);
+        row_pointers = NULL;
+
+        ppng_read_end(This->png_ptr, This->end_info);
+
+        This->window_rows = This->next_row = This->height;
+    }
 
     /* Find the metadata chunks in the file. */
     seek.QuadPart = 8;
@@ -807,9 +915,6 @@ static HRESULT WINAPI PngDecoder_Initialize(IWICBitmapDecoder *iface, IStream *p
         seek.QuadPart = chunk_start.QuadPart + chunk_size + 12; /* skip data and CRC */
     } while (memcmp(chunk_type, "IEND", 4));
 
-    This->stream = pIStream;
-    IStream_AddRef(This->stream);
-
     This->initialized = TRUE;
 
 end:
@@ -1099,11 +1204,65 @@ static HRESULT WINAPI PngDecoder_Frame_CopyPixels(IWICBitmapFrameDecode *iface,
     const WICRect *prc, UINT cbStride, UINT cbBufferSize, BYTE *pbBuffer)
 {
     PngDecoder *This = impl_from_IWICBitmapFrameDecode(iface);
+    WICRect rect, chunk_rect;
+    UINT bytesperrow, chunk, y;
+    HRESULT hr;
+
     TRACE("(%p,%s,%u,%u,%p)\n", iface, debug_wic_rect(prc), cbStride, cbBufferSize, pbBuffer);
 
-    return copy_pixels(This->bpp, This->image_bits,
-        This->width, This->height, This->stride,
-        prc, cbStride, cbBufferSize, pbBuffer);
+    if (!prc)
+    {
+        rect.X = 0;
+        rect.Y = 0;
+        rect.Width = This->width;
+        rect.Height = This->height;
+    }
+    else
+    {
+        if (prc->X < 0 || prc->Y < 0 || prc->X+prc->Width > This->width ||
+            prc->Y+prc->Height > This->height)
+            return E_INVALIDARG;
+        rect = *prc;
+    }
+
+    EnterCriticalSection(&This->lock);
+
+    if (rect.Height <= 0)
+    {
+        hr = copy_pixels(This->bpp, This->image_bits, This->width, This->height, This->stride,
+            &rect, cbStride, cbBufferSize, pbBuffer);
+        goto end;
+    }
+
+    /* check the whole buffer first, it is filled in pieces */
+    bytesperrow = (This->bpp * rect.Width + 7) / 8;
+    if (cbStride < bytesperrow || (ULONGLONG)cbStride * (rect.Height - 1) + bytesperrow > cbBufferSize)
+    {
+        hr = E_INVALIDARG;
+        goto end;
+    }
+
+    /* large images are copied in pieces that fit in the decoding window */
+    chunk = This->window_rows >= This->height ? This->height : This->window_rows / 2;
+    for (y = 0; y < rect.Height; y += chunk_rect.Height)
+    {
+        chunk_rect = rect;
+        chunk_rect.Y = rect.Y + y;
+        chunk_rect.Height = min(rect.Height - y, chunk);
+        hr = decode_rows(This, chunk_rect.Y, chunk_rect.Y + chunk_rect.Height);
+        if (FAILED(hr)) break;
+
+        chunk_rect.Y -= This->cache_first;
+        hr = copy_pixels(This->bpp, This->image_bits,
+            This->width, This->next_row - This->cache_first, This->stride,
+            &chunk_rect, cbStride, cbBufferSize - cbStride * y, pbBuffer + cbStride * y);
+        if (FAILED(hr)) break;
+    }
+
+end:
+    LeaveCriticalSection(&This->lock);
+
+    return hr;
 }
 
 static HRESULT WINAPI PngDecoder_Frame_GetMetadataQueryReader(IWICBitmapFrameDecode *iface,
@@ -1235,6 +1394,9 @@ static HRESULT WINAPI PngDecoder_Block_GetReaderByIndex(IWICMetadataBlockReader
     if (nIndex >= This->metadata_count || !ppIMetadataReader)
         return E_INVALIDARG;
 
+    /* the metadata is read from the stream shared with the pixel decoder */
+    EnterCriticalSection(&This->lock);
+
     if (!This->metadata_blocks[nIndex].reader)
     {
         hr = StreamImpl_Create(&stream);
@@ -1261,6 +1423,7 @@ static HRESULT WINAPI PngDecoder_Block_GetReaderByIndex(IWICMetadataBlockReader
 
         if (FAILED(hr))
         {
+            LeaveCriticalSection(&This->lock);
             *ppIMetadataReader = NULL;
             return hr;
         }
@@ -1269,6 +1432,8 @@ static HRESULT WINAPI PngDecoder_Block_GetReaderByIndex(IWICMetadataBlockReader
     *ppIMetadataReader = This->metadata_blocks[nIndex].reader;
     IWICMetadataReader_AddRef(*ppIMetadataReader);
 
+    LeaveCriticalSection(&This->lock);
+
     return S_OK;
 }
 
@@ -1317,6 +1482,8 @@ HRESULT PngDecoder_CreateInstance(REFIID iid, void** ppv)
     This->stream = NULL;
     This->initialized = FALSE;
     This->image_bits = NULL;
+    This->cache_first = This->window_rows = This->next_row = 0;
+    This->decode_failed = FALSE;
     InitializeCriticalSection(&This->lock);
     This->lock.DebugInfo->Spare[0] = (DWORD_PTR)(__FILE__ ": PngDecoder.lock");
     This->metadata_count = 0;
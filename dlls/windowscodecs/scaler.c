@@ -19,6 +19,7 @@
 #include "config.h"
 
 #include <stdarg.h>
+#include <math.h>
 
 #define COBJMACROS
 
@@ -32,6 +33,27 @@
 
 WINE_DEFAULT_DEBUG_CHANNEL(wincodecs);
 
+/* filter weights are fixed point with FILTER_BITS fractional bits, and
+ * horizontally filtered pixels keep INTERMEDIATE_BITS fractional bits */
+#define FILTER_BITS 14
+#define INTERMEDIATE_BITS 6
+
+/* number of source rows requested at once when filtering */
+#define FILTER_BAND_ROWS 16
+
+struct filter_contrib
+{
+    UINT start;     /* first source pixel */
+    UINT count;     /* number of source pixels */
+    UINT weights;   /* index of the first weight */
+};
+
+struct filter_table
+{
+    struct filter_contrib *contribs;
+    short *weights;
+};
+
 typedef struct BitmapScaler {
     IWICBitmapScaler IWICBitmapScaler_iface;
     LONG ref;
@@ -40,8 +62,10 @@ typedef struct BitmapScaler {
     UINT src_width, src_height;
     WICBitmapInterpolationMode mode;
     UINT bpp;
+    BOOL premultiply; /* straight alpha, filtered in premultiplied space */
     void (*fn_get_required_source_rect)(struct BitmapScaler*,UINT,UINT,WICRect*);
     void (*fn_copy_scanline)(struct BitmapScaler*,UINT,UINT,UINT,BYTE**,UINT,UINT,BYTE*);
+    struct filter_table filter_x, filter_y; /* only used by the filtering modes */
     CRITICAL_SECTION lock; /* must be held when initialized */
 } BitmapScaler;
 
@@ -84,6 +108,14 @@ static ULONG WINAPI BitmapScaler_AddRef(IWICBitmapScaler *iface)
     return ref;
 }
 
+static void free_filter_table(struct filter_table *table)
+{
+    HeapFree(GetProcessHeap(), 0, table->contribs);
+    HeapFree(GetProcessHeap(), 0, table->weights);
+    table->contribs = NULL;
+    table->weights = NULL;
+}
+
 static ULONG WINAPI BitmapScaler_Release(IWICBitmapScaler *iface)
 {
     BitmapScaler *This = impl_from_IWICBitmapScaler(iface);
@@ -96,6 +128,8 @@ static ULONG WINAPI BitmapScaler_Release(IWICBitmapScaler *iface)
         This->lock.DebugInfo->Spare[0] = 0;
         DeleteCriticalSection(&This->lock);
         if (This->source) IWICBitmapSource_Release(This->source);
+        free_filter_table(&This->filter_x);
+        free_filter_table(&This->filter_y);
         HeapFree(GetProcessHeap(), 0, This);
     }
 
@@ -193,6 +227,334 @@ static void NearestNeighbor_CopyScanline(BitmapScaler *This,
     }
 }
 
+static double filter_linear(double x)
+{
+    x = fabs(x);
+    return x < 1.0 ? 1.0 - x : 0.0;
+}
+
+/* Catmull-Rom spline */
+static double filter_cubic(double x)
+{
+    x = fabs(x);
+    if (x < 1.0) return (1.5 * x - 2.5) * x * x + 1.0;
+    if (x < 2.0) return ((-0.5 * x + 2.5) * x - 4.0) * x + 2.0;
+    return 0.0;
+}
+
+/* Computes for each destination pixel the range of source pixels it
+ * depends on and their weights. Filters are widened when downscaling so
+ * that every source pixel contributes, and Fant is the exact coverage of
+ * the source pixels by the destination pixel. */
+static HRESULT init_filter_table(struct filter_table *table, UINT src_size, UINT dst_size,
+    WICBitmapInterpolationMode mode)
+{
+    double scale = (double)src_size / dst_size;
+    double filter_scale = max(scale, 1.0);
+    double support, center, weight, total;
+    double *values;
+    UINT i, j, start, count, first, last, max_count, biggest;
+    int left, right, k, sum;
+    short *weights;
+
+    switch (mode)
+    {
+    case WICBitmapInterpolationModeLinear:
+        support = 1.0;
+        break;
+    case WICBitmapInterpolationModeCubic:
+        support = 2.0;
+        break;
+    default:
+        support = 0.5;
+        break;
+    }
+    support *= filter_scale;
+    max_count = (UINT)ceil(support * 2.0) + 2;
+
+    table->contribs = HeapAlloc(GetProcessHeap(), 0, dst_size * sizeof(*table->contribs));
+    table->weights = HeapAlloc(GetProcessHeap(), 0, dst_size * max_count * sizeof(*table->weights));
+    values = HeapAlloc(GetProcessHeap(), 0, max_count * sizeof(*values));
+    if (!table->contribs || !table->weights || !values)
+    {
+        free_filter_table(table);
+        HeapFree(GetProcessHeap(), 0, values);
+        return E_OUTOFMEMORY;
+    }
+
+    for (i = 0; i < dst_size; i++)
+    {
+        center = (i + 0.5) * scale - 0.5;
+        left = (int)floor(center - support);
+        right = (int)ceil(center + support);
+        start = max(left, 0);
+        count = min(right, (int)src_size - 1) - start + 1;
+
+        /* pixels past the edges are replaced by the edge pixels */
+        memset(values, 0, count * sizeof(*values));
+        total = 0.0;
+        for (k = left; k <= right; k++)
+        {
+            if (mode == WICBitmapInterpolationModeFant)
+                weight = min(k + 0.5, center + support) - max(k - 0.5, center - support);
+            else if (mode == WICBitmapInterpolationModeCubic)
+                weight = filter_cubic((k - center) / filter_scale);
+            else
+                weight = filter_linear((k - center) / filter_scale);
+            if (weight <= 0.0 && mode != WICBitmapInterpolationModeCubic) continue;
+            values[min(max(k, 0), (int)src_size - 1) - start] += weight;
+            total += weight;
+        }
+        if (total == 0.0)
+        {
+            values[0] = total = 1.0;
+        }
+
+        for (first = 0; first + 1 < count && values[first] == 0.0; first++);
+        for (last = count - 1; last > first && values[last] == 0.0; last--);
+
+        table->contribs[i].start = start + first;
+        table->contribs[i].count = last - first + 1;
+        table->contribs[i].weights = i * max_count;
+        weights = table->weights + i * max_count;
+
+        sum = 0;
+        biggest = 0;
+        for (j = 0; j <= last - first; j++)
+        {
+            weights[j] = (short)floor(values[first + j] / total * (1 << FILTER_BITS) + 0.5);
+            sum += weights[j];
+            if (weights[j] > weights[biggest]) biggest = j;
+        }
+        /* make sure that the weights add up to exactly one */
+        weights[biggest] += (1 << FILTER_BITS) - sum;
+    }
+
+    HeapFree(GetProcessHeap(), 0, values);
+    return S_OK;
+}
+
+static void filter_row_horizontal(const struct filter_table *table, UINT dst_x, UINT width,
+    UINT channels, const BYTE *src, UINT src_x, short *dst)
+{
+    const struct filter_contrib *contrib = table->contribs + dst_x;
+    const short *w;
+    const BYTE *p;
+    UINT x, i, c;
+    int sum;
+
+    /* most images are 32bpp, keep the four channels in separate
+     * accumulators so that the compiler can vectorize the loop */
+    if (channels == 4)
+    {
+        int b, g, r, a;
+
+        for (x = 0; x < width; x++, contrib++, dst += 4)
+        {
+            p = src + (contrib->start - src_x) * 4;
+            w = table->weights + contrib->weights;
+            b = g = r = a = 1 << (FILTER_BITS - INTERMEDIATE_BITS - 1);
+            for (i = 0; i < contrib->count; i++, p += 4)
+            {
+                b += w[i] * p[0];
+                g += w[i] * p[1];
+                r += w[i] * p[2];
+                a += w[i] * p[3];
+            }
+            dst[0] = b >> (FILTER_BITS - INTERMEDIATE_BITS);
+            dst[1] = g >> (FILTER_BITS - INTERMEDIATE_BITS);
+            dst[2] = r >> (FILTER_BITS - INTERMEDIATE_BITS);
+            dst[3] = a >> (FILTER_BITS - INTERMEDIATE_BITS);
+        }
+        return;
+    }
+
+    for (x = 0; x < width; x++, contrib++, dst += channels)
+    {
+        w = table->weights + contrib->weights;
+        for (c = 0; c < channels; c++)
+        {
+            p = src + (contrib->start - src_x) * channels + c;
+            sum = 1 << (FILTER_BITS - INTERMEDIATE_BITS - 1);
+            for (i = 0; i < contrib->count; i++, p += channels)
+                sum += w[i] * *p;
+            dst[c] = sum >> (FILTER_BITS - INTERMEDIATE_BITS);
+        }
+    }
+}
+
+static void filter_row_vertical(const struct filter_table *table, UINT dst_y, const short *src,
+    UINT row_size, int *accum, BYTE *dst)
+{
+    const struct filter_contrib *contrib = table->contribs + dst_y;
+    const short *w = table->weights + contrib->weights;
+    UINT x, i;
+    int value;
+
+    for (x = 0; x < row_size; x++)
+        accum[x] = 1 << (FILTER_BITS + INTERMEDIATE_BITS - 1);
+
+    for (i = 0; i < contrib->count; i++, src += row_size)
+    {
+        for (x = 0; x < row_size; x++)
+            accum[x] += w[i] * src[x];
+    }
+
+    for (x = 0; x < row_size; x++)
+    {
+        value = accum[x] >> (FILTER_BITS + INTERMEDIATE_BITS);
+        dst[x] = value < 0 ? 0 : (value > 255 ? 255 : value);
+    }
+}
+
+/* straight alpha must be filtered in premultiplied space, otherwise the
+ * colour of transparent pixels bleeds into their neighbours */
+static void premultiply_alpha(BYTE *bits, UINT count)
+{
+    UINT i;
+
+    for (i = 0; i < count; i++, bits += 4)
+    {
+        if (bits[3] == 255) continue;
+        bits[0] = (bits[0] * bits[3] + 127) / 255;
+        bits[1] = (bits[1] * bits[3] + 127) / 255;
+        bits[2] = (bits[2] * bits[3] + 127) / 255;
+    }
+}
+
+static void unpremultiply_alpha(BYTE *bits, UINT count)
+{
+    UINT i, c;
+
+    for (i = 0; i < count; i++, bits += 4)
+    {
+        if (bits[3] == 255) continue;
+        if (!bits[3])
+        {
+            bits[0] = bits[1] = bits[2] = 0;
+            continue;
+        }
+        for (c = 0; c < 3; c++)
+            bits[c] = min(255, (bits[c] * 255 + bits[3] / 2) / bits[3]);
+    }
+}
+
+/* Filters the horizontal direction first, reading the source in bands of
+ * rows, then combines the filtered rows for each destination row. Only the
+ * filtered rows still needed by the following destination rows are kept. */
+static HRESULT Filter_CopyPixels(BitmapScaler *This, const WICRect *dst_rect,
+    UINT stride, BYTE *buffer)
+{
+    UINT channels = This->bpp / 8;
+    UINT src_x0 = ~0u, src_x1 = 0, src_y1 = 0, max_rows = 0;
+    UINT x, y, i, rows, row_size, src_stride, window_start, window_end, window_size;
+    const struct filter_contrib *contrib;
+    WICRect src_rect;
+    short *rows_buffer;
+    BYTE *src_bits;
+    int *accum;
+    HRESULT hr = S_OK;
+
+    if (!dst_rect->Width || !dst_rect->Height)
+        return S_OK;
+
+    for (x = 0; x < dst_rect->Width; x++)
+    {
+        contrib = &This->filter_x.contribs[dst_rect->X + x];
+        src_x0 = min(src_x0, contrib->start);
+        src_x1 = max(src_x1, contrib->start + contrib->count);
+    }
+    for (y = 0; y < dst_rect->Height; y++)
+    {
+        contrib = &This->filter_y.contribs[dst_rect->Y + y];
+        src_y1 = max(src_y1, contrib->start + contrib->count);
+        max_rows = max(max_rows, contrib->count);
+    }
+
+    row_size = dst_rect->Width * channels;
+    src_stride = (src_x1 - src_x0) * channels;
+    window_size = max_rows + FILTER_BAND_ROWS;
+    rows_buffer = HeapAlloc(GetProcessHeap(), 0, window_size * row_size * sizeof(*rows_buffer));
+    src_bits = HeapAlloc(GetProcessHeap(), 0, FILTER_BAND_ROWS * src_stride);
+    accum = HeapAlloc(GetProcessHeap(), 0, row_size * sizeof(*accum));
+    if (!rows_buffer || !src_bits || !accum)
+    {
+        hr = E_OUTOFMEMORY;
+        goto end;
+    }
+
+    src_rect.X = src_x0;
+    src_rect.Width = src_x1 - src_x0;
+    window_start = window_end = This->filter_y.contribs[dst_rect->Y].start;
+
+    for (y = 0; y < dst_rect->Height; y++)
+    {
+        contrib = &This->filter_y.contribs[dst_rect->Y + y];
+
+        /* drop the rows that the following destination rows don't need */
+        if (contrib->start < window_start || contrib->start >= window_end)
+            window_start = window_end = contrib->start;
+        else if (contrib->start + contrib->count > window_end && contrib->start > window_start)
+        {
+            memmove(rows_buffer, rows_buffer + (contrib->start - window_start) * row_size,
+                (window_end - contrib->start) * row_size * sizeof(*rows_buffer));
+            window_start = contrib->start;
+        }
+
+        while (window_end < contrib->start + contrib->count)
+        {
+            rows = min(FILTER_BAND_ROWS, src_y1 - window_end);
+            rows = min(rows, window_size - (window_end - window_start));
+            src_rect.Y = window_end;
+            src_rect.Height = rows;
+            hr = IWICBitmapSource_CopyPixels(This->source, &src_rect, src_stride,
+                rows * src_stride, src_bits);
+            if (FAILED(hr)) goto end;
+            if (This->premultiply)
+                premultiply_alpha(src_bits, rows * src_rect.Width);
+
+            for (i = 0; i < rows; i++)
+                filter_row_horizontal(&This->filter_x, dst_rect->X, dst_rect->Width, channels,
+                    src_bits + i * src_stride, src_x0,
+                    rows_buffer + (window_end + i - window_start) * row_size);
+            window_end += rows;
+        }
+
+        filter_row_vertical(&This->filter_y, dst_rect->Y + y,
+            rows_buffer + (contrib->start - window_start) * row_size, row_size, accum,
+            buffer + stride * y);
+        if (This->premultiply)
+            unpremultiply_alpha(buffer + stride * y, dst_rect->Width);
+    }
+
+end:
+    HeapFree(GetProcessHeap(), 0, rows_buffer);
+    HeapFree(GetProcessHeap(), 0, src_bits);
+    HeapFree(GetProcessHeap(), 0, accum);
+    return hr;
+}
+
+static BOOL is_filterable_format(const WICPixelFormatGUID *format)
+{
+    /* formats with one byte per channel and no palette */
+    static const WICPixelFormatGUID *formats[] =
+    {
+        &GUID_WICPixelFormat8bppGray,
+        &GUID_WICPixelFormat24bppBGR,
+        &GUID_WICPixelFormat24bppRGB,
+        &GUID_WICPixelFormat32bppBGR,
+        &GUID_WICPixelFormat32bppBGRA,
+        &GUID_WICPixelFormat32bppPBGRA,
+        &GUID_WICPixelFormat32bppRGBA,
+        &GUID_WICPixelFormat32bppPRGBA,
+    };
+    UINT i;
+
+    for (i = 0; i < ARRAY_SIZE(formats); i++)
+        if (IsEqualGUID(format, formats[i])) return TRUE;
+    return FALSE;
+}
+
 static HRESULT WINAPI BitmapScaler_CopyPixels(IWICBitmapScaler *iface,
     const WICRect *prc, UINT cbStride, UINT cbBufferSize, BYTE *pbBuffer)
 {
@@ -247,6 +609,12 @@ static HRESULT WINAPI BitmapScaler_CopyPixels(IWICBitmapScaler *iface,
         goto end;
     }
 
+    if (This->filter_x.contribs)
+    {
+        hr = Filter_CopyPixels(This, &dest_rect, cbStride, pbBuffer);
+        goto end;
+    }
+
     /* MSDN recommends calling CopyPixels once for each scanline from top to
      * bottom, and claims codecs optimize for this. Ideally, when called in this
      * way, we should avoid requesting a scanline from the source more than
@@ -341,25 +709,54 @@ static HRESULT WINAPI BitmapScaler_Initialize(IWICBitmapScaler *iface,
     {
         switch (mode)
         {
-        default:
-            FIXME("unsupported mode %i\n", mode);
-            /* fall-through */
-        case WICBitmapInterpolationModeNearestNeighbor:
-            if ((This->bpp % 8) == 0)
+        case WICBitmapInterpolationModeLinear:
+        case WICBitmapInterpolationModeCubic:
+        case WICBitmapInterpolationModeFant:
+            /* the output keeps the source format, so formats which can't be
+             * filtered channel by channel are scaled by nearest neighbor */
+            if (!is_filterable_format(&src_pixelformat))
             {
-                IWICBitmapSource_AddRef(pISource);
-                This->source = pISource;
+                TRACE("using nearest neighbor for %s\n", debugstr_guid(&src_pixelformat));
+                break;
             }
-            else
+            IWICBitmapSource_AddRef(pISource);
+            This->source = pISource;
+            This->premultiply = IsEqualGUID(&src_pixelformat, &GUID_WICPixelFormat32bppBGRA) ||
+                                IsEqualGUID(&src_pixelformat, &GUID_WICPixelFormat32bppRGBA);
+            hr = init_filter_table(&This->filter_x, This->src_width, This->width, mode);
+            if (SUCCEEDED(hr))
+                hr = init_filter_table(&This->filter_y, This->src_height, This->height, mode);
+            if (FAILED(hr))
             {
-                hr = WICConvertBitmapSource(&GUID_WICPixelFormat32bppBGRA,
-                    pISource, &This->source);
-                This->bpp = 32;
+                free_filter_table(&This->filter_x);
+                free_filter_table(&This->filter_y);
+                IWICBitmapSource_Release(This->source);
+                This->source = NULL;
             }
-            This->fn_get_required_source_rect = NearestNeighbor_GetRequiredSourceRect;
-            This->fn_copy_scanline = NearestNeighbor_CopyScanline;
             break;
+        default:
+            FIXME("unsupported mode %i\n", mode);
+            break;
+        case WICBitmapInterpolationModeNearestNeighbor:
+            break;
+        }
+    }
+
+    if (SUCCEEDED(hr) && !This->filter_x.contribs)
+    {
+        if ((This->bpp % 8) == 0)
+        {
+            IWICBitmapSource_AddRef(pISource);
+            This->source = pISource;
+        }
+        else
+        {
+            hr = WICConvertBitmapSource(&GUID_WICPixelFormat32bppBGRA,
+                pISource, &This->source);
+            This->bpp = 32;
         }
+        This->fn_get_required_source_rect = NearestNeighbor_GetRequiredSourceRect;
+        This->fn_copy_scanline = NearestNeighbor_CopyScanline;
     }
 
 end:
@@ -396,6 +793,9 @@ HRESULT BitmapScaler_Create(IWICBitmapScaler **scaler)
     This->src_height = 0;
     This->mode = 0;
     This->bpp = 0;
+    This->premultiply = FALSE;
+    This->filter_x.contribs = This->filter_y.contribs = NULL;
+    This->filter_x.weights = This->filter_y.weights = NULL;
     InitializeCriticalSection(&This->lock);
     This->lock.DebugInfo->Spare[0] = (DWORD_PTR)(__FILE__ ": BitmapScaler.lock");
 
@@ -1245,6 +1245,183 @@ static void test_bitmap_scaler(void)
     IWICBitmap_Release(bitmap);
 }
 
+static void test_bitmap_scaler_filters(void)
+{
+    static const WICBitmapInterpolationMode modes[] =
+    {
+        WICBitmapInterpolationModeNearestNeighbor,
+        WICBitmapInterpolationModeLinear,
+        WICBitmapInterpolationModeCubic,
+        WICBitmapInterpolationModeFant,
+    };
+    static const UINT sizes[][2] = {{2, 2}, {3, 5}, {8, 8}};
+    static const BYTE gray_bits[] = {0x00,0x00,0x00,0xff, 0xff,0xff,0xff,0xff};
+    DWORD solid_bits[16], dst_bits[64];
+    WICPixelFormatGUID pixel_format;
+    IWICBitmapScaler *scaler;
+    IWICBitmap *bitmap;
+    BYTE gray[4];
+    UINT i, j, k;
+    HRESULT hr;
+
+    for (i = 0; i < ARRAY_SIZE(solid_bits); i++)
+        solid_bits[i] = 0xff336699;
+
+    hr = IWICImagingFactory_CreateBitmapFromMemory(factory, 4, 4, &GUID_WICPixelFormat32bppBGRA,
+        16, sizeof(solid_bits), (BYTE *)solid_bits, &bitmap);
+    ok(hr == S_OK, "Failed to create a bitmap, hr %#x.\n", hr);
+
+    for (i = 0; i < ARRAY_SIZE(modes); i++)
+    {
+        for (j = 0; j < ARRAY_SIZE(sizes); j++)
+        {
+            hr = IWICImagingFactory_CreateBitmapScaler(factory, &scaler);
+            ok(hr == S_OK, "Failed to create bitmap scaler, hr %#x.\n", hr);
+
+            hr = IWICBitmapScaler_Initialize(scaler, (IWICBitmapSource *)bitmap, sizes[j][0], sizes[j][1], modes[i]);
+            ok(hr == S_OK, "%u: Failed to initialize bitmap scaler, hr %#x.\n", modes[i], hr);
+
+            hr = IWICBitmapScaler_GetPixelFormat(scaler, &pixel_format);
+            ok(hr == S_OK, "Failed to get pixel format, hr %#x.\n", hr);
+            ok(IsEqualGUID(&pixel_format, &GUID_WICPixelFormat32bppBGRA), "%u: Unexpected pixel format %s.\n",
+                modes[i], wine_dbgstr_guid(&pixel_format));
+
+            memset(dst_bits, 0, sizeof(dst_bits));
+            hr = IWICBitmapScaler_CopyPixels(scaler, NULL, sizes[j][0] * 4, sizeof(dst_bits), (BYTE *)dst_bits);
+            ok(hr == S_OK, "%u: Failed to copy pixels, hr %#x.\n", modes[i], hr);
+            for (k = 0; k < sizes[j][0] * sizes[j][1]; k++)
+            {
+                ok(dst_bits[k] == 0xff336699, "%u: %ux%u: Unexpected pixel %u: %08x.\n",
+                    modes[i], sizes[j][0], sizes[j][1], k, dst_bits[k]);
+                if (dst_bits[k] != 0xff336699) break;
+            }
+
+            IWICBitmapScaler_Release(scaler);
+        }
+    }
+
+    IWICBitmap_Release(bitmap);
+
+    /* a black and a white pixel average to gray */
+    hr = IWICImagingFactory_CreateBitmapFromMemory(factory, 2, 1, &GUID_WICPixelFormat32bppBGRA,
+        8, sizeof(gray_bits), (BYTE *)gray_bits, &bitmap);
+    ok(hr == S_OK, "Failed to create a bitmap, hr %#x.\n", hr);
+
+    hr = IWICImagingFactory_CreateBitmapScaler(factory, &scaler);
+    ok(hr == S_OK, "Failed to create bitmap scaler, hr %#x.\n", hr);
+
+    hr = IWICBitmapScaler_Initialize(scaler, (IWICBitmapSource *)bitmap, 1, 1, WICBitmapInterpolationModeFant);
+    ok(hr == S_OK, "Failed to initialize bitmap scaler, hr %#x.\n", hr);
+
+    memset(gray, 0, sizeof(gray));
+    hr = IWICBitmapScaler_CopyPixels(scaler, NULL, 4, sizeof(gray), gray);
+    ok(hr == S_OK, "Failed to copy pixels, hr %#x.\n", hr);
+    for (i = 0; i < 3; i++)
+        ok(gray[i] == 0x7f || gray[i] == 0x80, "Unexpected channel %u value %#x.\n", i, gray[i]);
+    ok(gray[3] == 0xff, "Unexpected alpha %#x.\n", gray[3]);
+
+    IWICBitmapScaler_Release(scaler);
+    IWICBitmap_Release(bitmap);
+}
+
+static void test_bitmap_scaler_alpha(void)
+{
+    static const WICBitmapInterpolationMode modes[] =
+    {
+        WICBitmapInterpolationModeLinear,
+        WICBitmapInterpolationModeFant,
+    };
+    /* an opaque red pixel next to a transparent green one */
+    static const DWORD bleed_bits[] = {0xffff0000, 0x0000ff00};
+    static const WORD bgr555_bits[] = {0x7c00, 0x03e0, 0x001f, 0x7fff};
+    DWORD mixed_bits[5 * 40], dst_bits[3 * 13], pixel;
+    WICPixelFormatGUID pixel_format;
+    IWICBitmapScaler *scaler;
+    IWICBitmap *bitmap;
+    WORD bgr555[2];
+    UINT i, k;
+    HRESULT hr;
+
+    hr = IWICImagingFactory_CreateBitmapFromMemory(factory, 2, 1, &GUID_WICPixelFormat32bppBGRA,
+        8, sizeof(bleed_bits), (BYTE *)bleed_bits, &bitmap);
+    ok(hr == S_OK, "Failed to create a bitmap, hr %#x.\n", hr);
+
+    for (i = 0; i < ARRAY_SIZE(modes); i++)
+    {
+        hr = IWICImagingFactory_CreateBitmapScaler(factory, &scaler);
+        ok(hr == S_OK, "Failed to create bitmap scaler, hr %#x.\n", hr);
+
+        hr = IWICBitmapScaler_Initialize(scaler, (IWICBitmapSource *)bitmap, 1, 1, modes[i]);
+        ok(hr == S_OK, "%u: Failed to initialize bitmap scaler, hr %#x.\n", modes[i], hr);
+
+        pixel = 0;
+        hr = IWICBitmapScaler_CopyPixels(scaler, NULL, 4, sizeof(pixel), (BYTE *)&pixel);
+        ok(hr == S_OK, "%u: Failed to copy pixels, hr %#x.\n", modes[i], hr);
+        ok((pixel & 0xffffff) == 0xff0000, "%u: Unexpected colour %08x.\n", modes[i], pixel);
+        ok((pixel >> 24) == 0x7f || (pixel >> 24) == 0x80, "%u: Unexpected alpha %08x.\n", modes[i], pixel);
+
+        IWICBitmapScaler_Release(scaler);
+    }
+
+    IWICBitmap_Release(bitmap);
+
+    /* transparent pixels of another colour spread over several bands of rows */
+    for (i = 0; i < ARRAY_SIZE(mixed_bits); i++)
+        mixed_bits[i] = (i % 3) ? 0xff336699 : 0x00ffffff;
+
+    hr = IWICImagingFactory_CreateBitmapFromMemory(factory, 5, 40, &GUID_WICPixelFormat32bppBGRA,
+        20, sizeof(mixed_bits), (BYTE *)mixed_bits, &bitmap);
+    ok(hr == S_OK, "Failed to create a bitmap, hr %#x.\n", hr);
+
+    for (i = 0; i < ARRAY_SIZE(modes); i++)
+    {
+        hr = IWICImagingFactory_CreateBitmapScaler(factory, &scaler);
+        ok(hr == S_OK, "Failed to create bitmap scaler, hr %#x.\n", hr);
+
+        hr = IWICBitmapScaler_Initialize(scaler, (IWICBitmapSource *)bitmap, 3, 13, modes[i]);
+        ok(hr == S_OK, "%u: Failed to initialize bitmap scaler, hr %#x.\n", modes[i], hr);
+
+        memset(dst_bits, 0, sizeof(dst_bits));
+        hr = IWICBitmapScaler_CopyPixels(scaler, NULL, 12, sizeof(dst_bits), (BYTE *)dst_bits);
+        ok(hr == S_OK, "%u: Failed to copy pixels, hr %#x.\n", modes[i], hr);
+        for (k = 0; k < ARRAY_SIZE(dst_bits); k++)
+        {
+            pixel = dst_bits[k];
+            ok((pixel >> 24) >= 0x40, "%u: Unexpected alpha of pixel %u: %08x.\n", modes[i], k, pixel);
+            ok(abs((int)((pixel >> 16) & 0xff) - 0x33) <= 2 &&
+               abs((int)((pixel >> 8) & 0xff) - 0x66) <= 2 &&
+               abs((int)(pixel & 0xff) - 0x99) <= 2,
+               "%u: Unexpected colour of pixel %u: %08x.\n", modes[i], k, pixel);
+        }
+
+        IWICBitmapScaler_Release(scaler);
+    }
+
+    IWICBitmap_Release(bitmap);
+
+    /* formats that can't be filtered keep their format */
+    hr = IWICImagingFactory_CreateBitmapFromMemory(factory, 2, 2, &GUID_WICPixelFormat16bppBGR555,
+        4, sizeof(bgr555_bits), (BYTE *)bgr555_bits, &bitmap);
+    ok(hr == S_OK, "Failed to create a bitmap, hr %#x.\n", hr);
+
+    hr = IWICImagingFactory_CreateBitmapScaler(factory, &scaler);
+    ok(hr == S_OK, "Failed to create bitmap scaler, hr %#x.\n", hr);
+
+    hr = IWICBitmapScaler_Initialize(scaler, (IWICBitmapSource *)bitmap, 2, 1, WICBitmapInterpolationModeFant);
+    ok(hr == S_OK, "Failed to initialize bitmap scaler, hr %#x.\n", hr);
+
+    hr = IWICBitmapScaler_GetPixelFormat(scaler, &pixel_format);
+    ok(hr == S_OK, "Failed to get pixel format, hr %#x.\n", hr);
+    ok(IsEqualGUID(&pixel_format, &GUID_WICPixelFormat16bppBGR555), "Unexpected pixel format %s.\n",
+        wine_dbgstr_guid(&pixel_format));
+
+    hr = IWICBitmapScaler_CopyPixels(scaler, NULL, 4, sizeof(bgr555), (BYTE *)bgr555);
+    ok(hr == S_OK, "Failed to copy pixels, hr %#x.\n", hr);
+
+    IWICBitmapScaler_Release(scaler);
+    IWICBitmap_Release(bitmap);
+}
+
 START_TEST(bitmap)
 {
     HRESULT hr;
@@ -1262,6 +1439,8 @@ START_TEST(bitmap)
     test_CreateBitmapFromHBITMAP();
     test_clipper();
     test_bitmap_scaler();
+    test_bitmap_scaler_filters();
+    test_bitmap_scaler_alpha();
 
     IWICImagingFactory_Release(factory);
 
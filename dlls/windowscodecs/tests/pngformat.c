@@ -922,6 +922,118 @@ todo_wine_if(td[i].todo)
 #undef PNG_COLOR_TYPE_GRAY_ALPHA
 #undef PNG_COLOR_TYPE_RGB_ALPHA
 
+/* the decoded size is above 64 MB, so the image is decoded on demand */
+#define LARGE_WIDTH 16384
+#define LARGE_HEIGHT 4200
+
+static BYTE large_pixel(UINT x, UINT y)
+{
+    return (x + y * 3) & 0xff;
+}
+
+static IStream *create_large_png(void)
+{
+    WICPixelFormatGUID format = GUID_WICPixelFormat8bppGray;
+    IWICBitmapFrameEncode *frame;
+    IWICBitmapEncoder *encoder;
+    IStream *stream;
+    UINT x, y, i, count;
+    BYTE *rows;
+    HRESULT hr;
+
+    hr = CreateStreamOnHGlobal(NULL, TRUE, &stream);
+    ok(hr == S_OK, "CreateStreamOnHGlobal error %#x\n", hr);
+
+    hr = IWICImagingFactory_CreateEncoder(factory, &GUID_ContainerFormatPng, NULL, &encoder);
+    ok(hr == S_OK, "CreateEncoder error %#x\n", hr);
+    hr = IWICBitmapEncoder_Initialize(encoder, stream, WICBitmapEncoderNoCache);
+    ok(hr == S_OK, "Initialize error %#x\n", hr);
+    hr = IWICBitmapEncoder_CreateNewFrame(encoder, &frame, NULL);
+    ok(hr == S_OK, "CreateNewFrame error %#x\n", hr);
+    hr = IWICBitmapFrameEncode_Initialize(frame, NULL);
+    ok(hr == S_OK, "Initialize error %#x\n", hr);
+    hr = IWICBitmapFrameEncode_SetSize(frame, LARGE_WIDTH, LARGE_HEIGHT);
+    ok(hr == S_OK, "SetSize error %#x\n", hr);
+    hr = IWICBitmapFrameEncode_SetPixelFormat(frame, &format);
+    ok(hr == S_OK, "SetPixelFormat error %#x\n", hr);
+    ok(IsEqualGUID(&format, &GUID_WICPixelFormat8bppGray), "got format %s\n", wine_dbgstr_guid(&format));
+
+    rows = HeapAlloc(GetProcessHeap(), 0, 64 * LARGE_WIDTH);
+    for (y = 0; y < LARGE_HEIGHT; y += count)
+    {
+        count = min(64, LARGE_HEIGHT - y);
+        for (i = 0; i < count; i++)
+            for (x = 0; x < LARGE_WIDTH; x++)
+                rows[i * LARGE_WIDTH + x] = large_pixel(x, y + i);
+        hr = IWICBitmapFrameEncode_WritePixels(frame, count, LARGE_WIDTH, count * LARGE_WIDTH, rows);
+        ok(hr == S_OK, "WritePixels error %#x\n", hr);
+    }
+    HeapFree(GetProcessHeap(), 0, rows);
+
+    hr = IWICBitmapFrameEncode_Commit(frame);
+    ok(hr == S_OK, "Commit error %#x\n", hr);
+    hr = IWICBitmapEncoder_Commit(encoder);
+    ok(hr == S_OK, "Commit error %#x\n", hr);
+    IWICBitmapFrameEncode_Release(frame);
+    IWICBitmapEncoder_Release(encoder);
+    return stream;
+}
+
+static void check_large_rect(IWICBitmapFrameDecode *frame, UINT x0, UINT y0, UINT width, UINT height)
+{
+    WICRect rect = {x0, y0, width, height};
+    UINT x, y, errors = 0;
+    BYTE *bits;
+    HRESULT hr;
+
+    bits = HeapAlloc(GetProcessHeap(), 0, width * height);
+    hr = IWICBitmapFrameDecode_CopyPixels(frame, &rect, width, width * height, bits);
+    ok(hr == S_OK, "%u,%u: CopyPixels error %#x\n", x0, y0, hr);
+    for (y = 0; y < height && hr == S_OK; y++)
+        for (x = 0; x < width; x++)
+            if (bits[y * width + x] != large_pixel(x0 + x, y0 + y)) errors++;
+    ok(!errors, "%u,%u %ux%u: got %u wrong pixels\n", x0, y0, width, height, errors);
+    HeapFree(GetProcessHeap(), 0, bits);
+}
+
+static void test_large_image(void)
+{
+    IWICBitmapFrameDecode *frame;
+    IWICBitmapDecoder *decoder;
+    LARGE_INTEGER zero;
+    UINT y, width, height;
+    IStream *stream;
+    HRESULT hr;
+
+    stream = create_large_png();
+    zero.QuadPart = 0;
+    IStream_Seek(stream, zero, STREAM_SEEK_SET, NULL);
+
+    hr = IWICImagingFactory_CreateDecoderFromStream(factory, stream, NULL, 0, &decoder);
+    ok(hr == S_OK, "CreateDecoderFromStream error %#x\n", hr);
+    hr = IWICBitmapDecoder_GetFrame(decoder, 0, &frame);
+    ok(hr == S_OK, "GetFrame error %#x\n", hr);
+    hr = IWICBitmapFrameDecode_GetSize(frame, &width, &height);
+    ok(hr == S_OK, "GetSize error %#x\n", hr);
+    ok(width == LARGE_WIDTH && height == LARGE_HEIGHT, "got %ux%u\n", width, height);
+
+    /* overlapping bands from top to bottom */
+    for (y = 0; y + 20 <= LARGE_HEIGHT; y += 16)
+        check_large_rect(frame, 1000, y, 16, 20);
+    /* rows before the last band */
+    check_large_rect(frame, 0, LARGE_HEIGHT - 100, 64, 8);
+    /* rows before the decoding window */
+    check_large_rect(frame, 5, 10, 64, 8);
+    /* full rows covering several windows */
+    check_large_rect(frame, 0, 2000, LARGE_WIDTH, 700);
+    /* and back */
+    check_large_rect(frame, 3, 2690, 16, 20);
+
+    IWICBitmapFrameDecode_Release(frame);
+    IWICBitmapDecoder_Release(decoder);
+    IStream_Release(stream);
+}
+
 START_TEST(pngformat)
 {
     HRESULT hr;
@@ -935,6 +1047,7 @@ START_TEST(pngformat)
     test_color_contexts();
     test_png_palette();
     test_color_formats();
+    test_large_image();
 
     IWICImagingFactory_Release(factory);
     CoUninitialize();
@@ -348,6 +348,22 @@ static inline WCHAR *reader_get_strptr(const xmlreader *reader, const strval *v)
     return v->str ? v->str : reader_get_ptr2(reader, v->start);
 }
 
+/* Makes a null-terminated copy of a value that still points to input buffer. */
+static HRESULT reader_strval_ensure_allocated(xmlreader *reader, strval *v)
+{
+    WCHAR *ptr;
+
+    if (v->str) return S_OK;
+
+    ptr = reader_alloc(reader, (v->len+1)*sizeof(WCHAR));
+    if (!ptr) return E_OUTOFMEMORY;
+    memcpy(ptr, reader_get_ptr2(reader, v->start), v->len*sizeof(WCHAR));
+    ptr[v->len] = 0;
+    v->str = ptr;
+
+    return S_OK;
+}
+
 static HRESULT reader_strvaldup(xmlreader *reader, const strval *src, strval *dest)
 {
     *dest = *src;
@@ -420,7 +436,8 @@ static void reader_clear_attrs(xmlreader *reader)
 }
 
 /* attribute data holds pointers to buffer data, so buffer shrink is not possible
-   while we are on a node with attributes */
+   while we are on a node with attributes. Values are copied only when requested
+   with GetValue(). */
 static HRESULT reader_add_attr(xmlreader *reader, strval *prefix, strval *localname, strval *qname,
     strval *value, const struct reader_position *position, unsigned int flags)
 {
@@ -431,12 +448,6 @@ static HRESULT reader_add_attr(xmlreader *reader, strval *prefix, strval *localn
     if (!attr) return E_OUTOFMEMORY;
 
     hr = reader_strvaldup(reader, localname, &attr->localname);
-    if (hr == S_OK)
-    {
-        hr = reader_strvaldup(reader, value, &attr->value);
-        if (hr != S_OK)
-            reader_free_strvalued(reader, &attr->value);
-    }
     if (hr != S_OK)
     {
         reader_free(reader, attr);
@@ -448,6 +459,7 @@ static HRESULT reader_add_attr(xmlreader *reader, strval *prefix, strval *localn
     else
         memset(&attr->prefix, 0, sizeof(attr->prefix));
     attr->qname = qname ? *qname : *localname;
+    attr->value = *value;
     attr->position = *position;
     attr->flags = flags;
     list_add_tail(&reader->attrs, &attr->entry);
@@ -668,7 +680,8 @@ static void reader_pop_element(xmlreader *reader)
         reader->instate = XmlReadInState_MiscEnd;
 }
 
-/* Always make a copy, cause strings are supposed to be null terminated. Null pointer for 'value'
+/* Values pointing to input buffer are stored as is, a null-terminated copy is only made
+   when it's requested, see reader_strval_ensure_allocated(). Null pointer for 'value'
    means node value is to be determined. */
 static void reader_set_strvalue(xmlreader *reader, XmlReaderStringValue type, const strval *value)
 {
@@ -687,9 +700,9 @@ static void reader_set_strvalue(xmlreader *reader, XmlReaderStringValue type, co
         *v = *value;
     else
     {
-        if (type == StringValue_Value)
+        if (!value->str)
         {
-            /* defer allocation for value string */
+            /* defer allocation */
             v->str = NULL;
             v->start = value->start;
             v->len = value->len;
@@ -2216,9 +2229,17 @@ static HRESULT reader_parse_attvalue(xmlreader *reader, strval *value)
         }
         else
         {
-            /* replace all whitespace chars with ' ' */
-            if (is_wchar_space(*ptr)) *ptr = ' ';
-            reader_skipn(reader, 1);
+            WCHAR *end = ptr;
+
+            /* skip to next quote, reference or end of data at once */
+            do
+            {
+                /* replace all whitespace chars with ' ' */
+                if (is_wchar_space(*end)) *end = ' ';
+                reader_update_position(reader, *end);
+                end++;
+            } while (*end && *end != quote && *end != '<' && *end != '&');
+            reader->input->buffer->utf16.cur += end - ptr;
         }
         ptr = reader_get_ptr(reader);
     }
@@ -2474,8 +2495,6 @@ static HRESULT reader_parse_chardata(xmlreader *reader)
     position = reader->position;
     while (*ptr)
     {
-        static const WCHAR ampW[] = {'&',0};
-
         /* CDATA closing sequence ']]>' is not allowed */
         if (ptr[0] == ']' && ptr[1] == ']' && ptr[2] == '>')
             return WC_E_CDSECTEND;
@@ -2496,10 +2515,21 @@ static HRESULT reader_parse_chardata(xmlreader *reader)
         /* this covers a case when text has leading whitespace chars */
         if (!is_wchar_space(*ptr)) reader->nodetype = XmlNodeType_Text;
 
-        if (!reader_cmp(reader, ampW))
+        if (*ptr == '&')
             reader_parse_reference(reader);
         else
-            reader_skipn(reader, 1);
+        {
+            WCHAR *end = ptr;
+
+            /* skip to next markup, reference or possible ']]>' at once */
+            do
+            {
+                if (!is_wchar_space(*end)) reader->nodetype = XmlNodeType_Text;
+                reader_update_position(reader, *end);
+                end++;
+            } while (*end && *end != '<' && *end != '&' && *end != ']');
+            reader->input->buffer->utf16.cur += end - ptr;
+        }
 
         ptr = reader_get_ptr(reader);
     }
@@ -3148,6 +3178,7 @@ static HRESULT WINAPI xmlreader_GetQualifiedName(IXmlReader* iface, LPCWSTR *nam
 
     switch (reader_get_nodetype(This))
     {
+    case XmlNodeType_None:
     case XmlNodeType_Text:
     case XmlNodeType_CDATA:
     case XmlNodeType_Comment:
@@ -3176,6 +3207,8 @@ static HRESULT WINAPI xmlreader_GetQualifiedName(IXmlReader* iface, LPCWSTR *nam
             *len = 5;
         } else if (attribute->prefix.len)
         {
+            if (FAILED(reader_strval_ensure_allocated(This, &This->strvalues[StringValue_QualifiedName])))
+                return E_OUTOFMEMORY;
             *name = This->strvalues[StringValue_QualifiedName].str;
             *len = This->strvalues[StringValue_QualifiedName].len;
         }
@@ -3186,6 +3219,8 @@ static HRESULT WINAPI xmlreader_GetQualifiedName(IXmlReader* iface, LPCWSTR *nam
         }
         break;
     default:
+        if (FAILED(reader_strval_ensure_allocated(This, &This->strvalues[StringValue_QualifiedName])))
+            return E_OUTOFMEMORY;
         *name = This->strvalues[StringValue_QualifiedName].str;
         *len = This->strvalues[StringValue_QualifiedName].len;
         break;
@@ -3271,6 +3306,7 @@ static HRESULT WINAPI xmlreader_GetLocalName(IXmlReader* iface, LPCWSTR *name, U
 
     switch (reader_get_nodetype(This))
     {
+    case XmlNodeType_None:
     case XmlNodeType_Text:
     case XmlNodeType_CDATA:
     case XmlNodeType_Comment:
@@ -3288,6 +3324,8 @@ static HRESULT WINAPI xmlreader_GetLocalName(IXmlReader* iface, LPCWSTR *name, U
         reader_get_attribute_local_name(This, This->attr, name, len);
         break;
     default:
+        if (FAILED(reader_strval_ensure_allocated(This, &This->strvalues[StringValue_LocalName])))
+            return E_OUTOFMEMORY;
         *name = This->strvalues[StringValue_LocalName].str;
         *len = This->strvalues[StringValue_LocalName].len;
         break;
@@ -3365,20 +3403,15 @@ static const strval *reader_get_value(xmlreader *reader, BOOL ensure_allocated)
 
             return &ns->uri;
         }
-        return &reader->attr->value;
+        val = &reader->attr->value;
+        break;
     default:
+        val = &reader->strvalues[StringValue_Value];
         break;
     }
 
-    val = &reader->strvalues[StringValue_Value];
-    if (!val->str && ensure_allocated)
-    {
-        WCHAR *ptr = reader_alloc(reader, (val->len+1)*sizeof(WCHAR));
-        if (!ptr) return NULL;
-        memcpy(ptr, reader_get_strptr(reader, val), val->len*sizeof(WCHAR));
-        ptr[val->len] = 0;
-        val->str = ptr;
-    }
+    if (ensure_allocated && reader_strval_ensure_allocated(reader, val) != S_OK)
+        return NULL;
 
     return val;
 }
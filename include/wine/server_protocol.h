@@ -686,6 +686,17 @@ typedef union
 } irp_params_t;
 
 
+typedef volatile struct
+{
+    unsigned int   seq;
+    unsigned int   wake_bits;
+    unsigned int   changed_bits;
+    unsigned int   wake_mask;
+    unsigned int   changed_mask;
+    unsigned int   hooks_serial;
+} queue_shm_t;
+
+
 typedef struct
 {
     client_ptr_t   base;
@@ -3014,7 +3025,7 @@ struct get_msg_queue_reply
 {
     struct reply_header __header;
     obj_handle_t handle;
-    char __pad_12[4];
+    obj_handle_t shm;
 };
 
 
@@ -6554,6 +6565,6 @@ union generic_reply
     struct terminate_job_reply terminate_job_reply;
 };
 
-#define SERVER_PROTOCOL_VERSION 572
+#define SERVER_PROTOCOL_VERSION 574
 
 #endif /* __WINE_WINE_SERVER_PROTOCOL_H */
@@ -54,7 +54,7 @@ struct atom_entry
     int                count;  /* reference count */
     short              pinned; /* whether the atom is pinned or not */
     atom_t             atom;   /* atom handle */
-    unsigned short     hash;   /* string hash */
+    unsigned int       hash;   /* string hash */
     unsigned short     len;    /* string len */
     WCHAR              str[1]; /* atom string */
 };
@@ -64,6 +64,8 @@ struct atom_table
     struct object       obj;                 /* object header */
     int                 count;               /* count of atom handles */
     int                 last;                /* last handle in-use */
+    int                 first_free;          /* no free handle below this one */
+    int                 atoms;               /* number of atoms in the table */
     struct atom_entry **handles;             /* atom handles */
     int                 entries_count;       /* number of hash entries */
     struct atom_entry **entries;             /* hash table entries */
@@ -115,6 +117,8 @@ static struct atom_table *create_table(int entries_count)
         memset( table->entries, 0, sizeof(*table->entries) * table->entries_count );
         table->count = 64;
         table->last  = -1;
+        table->first_free = 0;
+        table->atoms = 0;
         if ((table->handles = mem_alloc( sizeof(*table->handles) * table->count )))
             return table;
 fail:
@@ -138,7 +142,7 @@ static struct atom_entry *get_atom_entry( struct atom_table *table, atom_t atom
 static atom_t add_atom_entry( struct atom_table *table, struct atom_entry *entry )
 {
     int i;
-    for (i = 0; i <= table->last; i++)
+    for (i = table->first_free; i <= table->last; i++)
         if (!table->handles[i]) goto found;
     if (i == table->count)
     {
@@ -158,17 +162,52 @@ static atom_t add_atom_entry( struct atom_table *table, struct atom_entry *entry
     table->last = i;
  found:
     table->handles[i] = entry;
+    table->first_free = i + 1;
+    table->atoms++;
     entry->atom = i + MIN_STR_ATOM;
     return entry->atom;
 }
 
-/* compute the hash code for a string */
-static unsigned short atom_hash( struct atom_table *table, const struct unicode_str *str )
+/* remove an atom entry from the handles and the hash table */
+static void remove_atom_entry( struct atom_table *table, struct atom_entry *entry )
 {
-    unsigned int i;
-    unsigned short hash = 0;
-    for (i = 0; i < str->len / sizeof(WCHAR); i++) hash ^= toupperW(str->str[i]) + i;
-    return hash % table->entries_count;
+    int index = entry->atom - MIN_STR_ATOM;
+
+    if (entry->next) entry->next->prev = entry->prev;
+    if (entry->prev) entry->prev->next = entry->next;
+    else table->entries[entry->hash % table->entries_count] = entry->next;
+    table->handles[index] = NULL;
+    if (index < table->first_free) table->first_free = index;
+    table->atoms--;
+    free( entry );
+}
+
+/* compute the case-insensitive hash code for a string */
+static unsigned int atom_hash( const struct unicode_str *str )
+{
+    unsigned int i, hash = 2166136261u;
+    for (i = 0; i < str->len / sizeof(WCHAR); i++) hash = (hash ^ toupperW(str->str[i])) * 16777619;
+    return hash;
+}
+
+/* grow the hash table to keep the chains short */
+static void grow_atom_hash( struct atom_table *table )
+{
+    struct atom_entry **entries, *entry;
+    int i, bucket, new_count = table->entries_count * 2 + 1;
+
+    if (!(entries = calloc( new_count, sizeof(*entries) ))) return;  /* keep the old one */
+    for (i = 0; i <= table->last; i++)
+    {
+        if (!(entry = table->handles[i])) continue;
+        bucket = entry->hash % new_count;
+        entry->prev = NULL;
+        if ((entry->next = entries[bucket])) entry->next->prev = entry;
+        entries[bucket] = entry;
+    }
+    free( table->entries );
+    table->entries = entries;
+    table->entries_count = new_count;
 }
 
 /* dump an atom table */
@@ -178,14 +217,14 @@ static void atom_table_dump( struct object *obj, int verbose )
     struct atom_table *table = (struct atom_table *)obj;
     assert( obj->ops == &atom_table_ops );
 
-    fprintf( stderr, "Atom table size=%d entries=%d\n",
-             table->last + 1, table->entries_count );
+    fprintf( stderr, "Atom table size=%d atoms=%d entries=%d\n",
+             table->last + 1, table->atoms, table->entries_count );
     if (!verbose) return;
     for (i = 0; i <= table->last; i++)
     {
         struct atom_entry *entry = table->handles[i];
         if (!entry) continue;
-        fprintf( stderr, "  %04x: ref=%d pinned=%c hash=%d \"",
+        fprintf( stderr, "  %04x: ref=%d pinned=%c hash=%08x \"",
                  entry->atom, entry->count, entry->pinned ? 'Y' : 'N', entry->hash );
         dump_strW( entry->str, entry->len / sizeof(WCHAR), stderr, "\"\"");
         fprintf( stderr, "\"\n" );
@@ -208,12 +247,13 @@ static void atom_table_destroy( struct object *obj )
 
 /* find an atom entry in its hash list */
 static struct atom_entry *find_atom_entry( struct atom_table *table, const struct unicode_str *str,
-                                           unsigned short hash )
+                                           unsigned int hash )
 {
-    struct atom_entry *entry = table->entries[hash];
+    struct atom_entry *entry = table->entries[hash % table->entries_count];
     while (entry)
     {
-        if (entry->len == str->len && !memicmpW( entry->str, str->str, str->len/sizeof(WCHAR) )) break;
+        if (entry->hash == hash && entry->len == str->len &&
+            !memicmpW( entry->str, str->str, str->len/sizeof(WCHAR) )) break;
         entry = entry->next;
     }
     return entry;
@@ -223,7 +263,7 @@ static struct atom_entry *find_atom_entry( struct atom_table *table, const struc
 static atom_t add_atom( struct atom_table *table, const struct unicode_str *str )
 {
     struct atom_entry *entry;
-    unsigned short hash = atom_hash( table, str );
+    unsigned int hash = atom_hash( str );
     atom_t atom = 0;
 
     if (!str->len)
@@ -242,13 +282,15 @@ static atom_t add_atom( struct atom_table *table, const struct unicode_str *str
         return entry->atom;
     }
 
+    if (table->atoms >= 2 * table->entries_count) grow_atom_hash( table );
+
     if ((entry = mem_alloc( FIELD_OFFSET( struct atom_entry, str[str->len / sizeof(WCHAR)] ) )))
     {
         if ((atom = add_atom_entry( table, entry )))
         {
             entry->prev  = NULL;
-            if ((entry->next = table->entries[hash])) entry->next->prev = entry;
-            table->entries[hash] = entry;
+            if ((entry->next = table->entries[hash % table->entries_count])) entry->next->prev = entry;
+            table->entries[hash % table->entries_count] = entry;
             entry->count  = 1;
             entry->pinned = 0;
             entry->hash   = hash;
@@ -267,14 +309,7 @@ static void delete_atom( struct atom_table *table, atom_t atom, int if_pinned )
     struct atom_entry *entry = get_atom_entry( table, atom );
     if (!entry) return;
     if (entry->pinned && !if_pinned) set_error( STATUS_WAS_LOCKED );
-    else if (!--entry->count)
-    {
-        if (entry->next) entry->next->prev = entry->prev;
-        if (entry->prev) entry->prev->next = entry->next;
-        else table->entries[entry->hash] = entry->next;
-        table->handles[atom - MIN_STR_ATOM] = NULL;
-        free( entry );
-    }
+    else if (!--entry->count) remove_atom_entry( table, entry );
 }
 
 /* find an atom in the table */
@@ -292,7 +327,7 @@ static atom_t find_atom( struct atom_table *table, const struct unicode_str *str
         set_error( STATUS_INVALID_PARAMETER );
         return 0;
     }
-    if (table && (entry = find_atom_entry( table, str, atom_hash(table, str) )))
+    if (table && (entry = find_atom_entry( table, str, atom_hash( str ) )))
         return entry->atom;
     set_error( STATUS_OBJECT_NAME_NOT_FOUND );
     return 0;
@@ -349,7 +384,7 @@ atom_t find_global_atom( struct winstation *winstation, const struct unicode_str
     struct atom_entry *entry;
 
     if (!str->len || str->len > MAX_ATOM_LEN || !table) return 0;
-    if ((entry = find_atom_entry( table, str, atom_hash(table, str) )))
+    if ((entry = find_atom_entry( table, str, atom_hash( str ) )))
         return entry->atom;
     return 0;
 }
@@ -478,14 +513,7 @@ DECL_HANDLER(empty_atom_table)
         for (i = 0; i <= table->last; i++)
         {
             entry = table->handles[i];
-            if (entry && (!entry->pinned || req->if_pinned))
-            {
-                if (entry->next) entry->next->prev = entry->prev;
-                if (entry->prev) entry->prev->next = entry->next;
-                else table->entries[entry->hash] = entry->next;
-                table->handles[i] = NULL;
-                free( entry );
-            }
+            if (entry && (!entry->pinned || req->if_pinned)) remove_atom_entry( table, entry );
         }
         release_object( table );
     }
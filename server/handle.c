@@ -43,6 +43,7 @@ struct handle_entry
 {
     struct object *ptr;       /* object */
     unsigned int   access;    /* access rights */
+    int            next_free; /* next entry in the free list */
 };
 
 struct handle_table
@@ -51,8 +52,9 @@ struct handle_table
     struct process      *process;     /* process owning this table */
     int                  count;       /* number of allocated entries */
     int                  last;        /* last used entry */
-    int                  free;        /* first entry that may be free */
-    struct handle_entry *entries;     /* handle entries */
+    int                  used;        /* number of entries that have ever been used */
+    int                  free;        /* head of the free entries list, or -1 */
+    struct handle_entry **chunks;     /* handle entries, in chunks of HANDLE_CHUNK_SIZE */
 };
 
 static struct handle_table *global_table;
@@ -63,7 +65,9 @@ static struct handle_table *global_table;
 #define RESERVED_CLOSE_PROTECT (HANDLE_FLAG_PROTECT_FROM_CLOSE << RESERVED_SHIFT)
 #define RESERVED_ALL           (RESERVED_INHERIT | RESERVED_CLOSE_PROTECT)
 
-#define MIN_HANDLE_ENTRIES  32
+#define HANDLE_CHUNK_SHIFT  8
+#define HANDLE_CHUNK_SIZE   (1 << HANDLE_CHUNK_SHIFT)
+#define MIN_HANDLE_ENTRIES  HANDLE_CHUNK_SIZE
 #define MAX_HANDLE_ENTRIES  0x00ffffff
 
 
@@ -79,6 +83,12 @@ static inline int handle_to_index( obj_handle_t handle )
     return (handle >> 2) - 1;
 }
 
+/* entries live in fixed-size chunks so that growing the table never moves them */
+static inline struct handle_entry *get_entry( struct handle_table *table, int index )
+{
+    return table->chunks[index >> HANDLE_CHUNK_SHIFT] + (index & (HANDLE_CHUNK_SIZE - 1));
+}
+
 /* global handle conversion */
 
 #define HANDLE_OBFUSCATOR 0x544a4def
@@ -149,9 +159,9 @@ static void handle_table_dump( struct object *obj, int verbose )
     fprintf( stderr, "Handle table last=%d count=%d process=%p\n",
              table->last, table->count, table->process );
     if (!verbose) return;
-    entry = table->entries;
-    for (i = 0; i <= table->last; i++, entry++)
+    for (i = 0; i <= table->last; i++)
     {
+        entry = get_entry( table, i );
         if (!entry->ptr) continue;
         fprintf( stderr, "    %04x: %p %08x ",
                  index_to_handle(i), entry->ptr, entry->access );
@@ -172,20 +182,23 @@ static void handle_table_destroy( struct object *obj )
     /* first notify all objects that handles are being closed */
     if (table->process)
     {
-        for (i = 0, entry = table->entries; i <= table->last; i++, entry++)
+        for (i = 0; i <= table->last; i++)
         {
-            struct object *obj = entry->ptr;
+            struct object *obj = get_entry( table, i )->ptr;
             if (obj) obj->ops->close_handle( obj, table->process, index_to_handle(i) );
         }
     }
 
-    for (i = 0, entry = table->entries; i <= table->last; i++, entry++)
+    for (i = 0; i <= table->last; i++)
     {
-        struct object *obj = entry->ptr;
+        struct object *obj;
+        entry = get_entry( table, i );
+        obj = entry->ptr;
         entry->ptr = NULL;
         if (obj) release_object_from_handle( obj );
     }
-    free( table->entries );
+    for (i = 0; i < table->count >> HANDLE_CHUNK_SHIFT; i++) free( table->chunks[i] );
+    free( table->chunks );
 }
 
 /* close all the process handles and free the handle table */
@@ -197,19 +210,47 @@ void close_process_handles( struct process *process )
     if (table) release_object( table );
 }
 
+/* change the number of entry chunks of a handle table */
+/* count must be a multiple of HANDLE_CHUNK_SIZE */
+static int resize_handle_table( struct handle_table *table, int count )
+{
+    struct handle_entry **chunks;
+    int i, old_chunks = table->count >> HANDLE_CHUNK_SHIFT, new_chunks = count >> HANDLE_CHUNK_SHIFT;
+
+    if (new_chunks <= old_chunks)
+    {
+        for (i = new_chunks; i < old_chunks; i++) free( table->chunks[i] );
+        table->count = count;
+        if ((chunks = realloc( table->chunks, new_chunks * sizeof(*chunks) ))) table->chunks = chunks;
+        return 1;
+    }
+    if (!(chunks = realloc( table->chunks, new_chunks * sizeof(*chunks) ))) return 0;
+    table->chunks = chunks;
+    for (i = old_chunks; i < new_chunks; i++)
+    {
+        if (!(chunks[i] = malloc( HANDLE_CHUNK_SIZE * sizeof(*chunks[i]) ))) return 0;
+        table->count += HANDLE_CHUNK_SIZE;
+    }
+    return 1;
+}
+
 /* allocate a new handle table */
 struct handle_table *alloc_handle_table( struct process *process, int count )
 {
     struct handle_table *table;
 
     if (count < MIN_HANDLE_ENTRIES) count = MIN_HANDLE_ENTRIES;
+    count = (count + HANDLE_CHUNK_SIZE - 1) & ~(HANDLE_CHUNK_SIZE - 1);
     if (!(table = alloc_object( &handle_table_ops )))
         return NULL;
     table->process = process;
-    table->count   = count;
+    table->count   = 0;
     table->last    = -1;
-    table->free    = 0;
-    if ((table->entries = mem_alloc( count * sizeof(*table->entries) ))) return table;
+    table->used    = 0;
+    table->free    = -1;
+    table->chunks  = NULL;
+    if (resize_handle_table( table, count )) return table;
+    set_error( STATUS_NO_MEMORY );
     release_object( table );
     return NULL;
 }
@@ -217,35 +258,44 @@ struct handle_table *alloc_handle_table( struct process *process, int count )
 /* grow a handle table */
 static int grow_handle_table( struct handle_table *table )
 {
-    struct handle_entry *new_entries;
-    int count = min( table->count * 2, MAX_HANDLE_ENTRIES );
+    int count = min( table->count * 2, MAX_HANDLE_ENTRIES & ~(HANDLE_CHUNK_SIZE - 1) );
 
-    if (count == table->count ||
-        !(new_entries = realloc( table->entries, count * sizeof(struct handle_entry) )))
+    if (count == table->count || !resize_handle_table( table, count ))
     {
         set_error( STATUS_INSUFFICIENT_RESOURCES );
         return 0;
     }
-    table->entries = new_entries;
-    table->count   = count;
     return 1;
 }
 
-/* allocate the first free entry in the handle table */
+/* put an unused entry at the head of the free list */
+static inline void free_entry( struct handle_table *table, int index )
+{
+    struct handle_entry *entry = get_entry( table, index );
+
+    entry->ptr       = NULL;
+    entry->next_free = table->free;
+    table->free      = index;
+}
+
+/* allocate a free entry in the handle table */
 static obj_handle_t alloc_entry( struct handle_table *table, void *obj, unsigned int access )
 {
-    struct handle_entry *entry = table->entries + table->free;
+    struct handle_entry *entry;
     int i;
 
-    for (i = table->free; i <= table->last; i++, entry++) if (!entry->ptr) goto found;
-    if (i >= table->count)
+    if ((i = table->free) != -1)
     {
-        if (!grow_handle_table( table )) return 0;
-        entry = table->entries + i;  /* the entries may have moved */
+        entry = get_entry( table, i );
+        table->free = entry->next_free;
     }
-    table->last = i;
- found:
-    table->free = i + 1;
+    else
+    {
+        if (table->used == table->count && !grow_handle_table( table )) return 0;
+        i = table->used++;
+        entry = get_entry( table, i );
+    }
+    if (i > table->last) table->last = i;
     entry->ptr    = grab_object_for_handle( obj );
     entry->access = access;
     return index_to_handle(i);
@@ -326,7 +376,7 @@ static struct handle_entry *get_handle( struct process *process, obj_handle_t ha
     index = handle_to_index( handle );
     if (index < 0) return NULL;
     if (index > table->last) return NULL;
-    entry = table->entries + index;
+    entry = get_entry( table, index );
     if (!entry->ptr) return NULL;
     return entry;
 }
@@ -334,22 +384,18 @@ static struct handle_entry *get_handle( struct process *process, obj_handle_t ha
 /* attempt to shrink a table */
 static void shrink_handle_table( struct handle_table *table )
 {
-    struct handle_entry *entry = table->entries + table->last;
-    struct handle_entry *new_entries;
-    int count = table->count;
+    int i, count = table->count;
 
-    while (table->last >= 0)
-    {
-        if (entry->ptr) break;
-        table->last--;
-        entry--;
-    }
+    while (table->last >= 0 && !get_entry( table, table->last )->ptr) table->last--;
     if (table->last >= count / 4) return;  /* no need to shrink */
     if (count < MIN_HANDLE_ENTRIES * 2) return;  /* too small to shrink */
-    count /= 2;
-    if (!(new_entries = realloc( table->entries, count * sizeof(*new_entries) ))) return;
-    table->count   = count;
-    table->entries = new_entries;
+    count = (count / 2) & ~(HANDLE_CHUNK_SIZE - 1);
+
+    /* rebuild the free list without the entries that are going away, lowest index first */
+    table->used = min( table->used, count );
+    table->free = -1;
+    for (i = table->used - 1; i >= 0; i--) if (!get_entry( table, i )->ptr) free_entry( table, i );
+    resize_handle_table( table, count );
 }
 
 /* copy the handle table of the parent process */
@@ -366,16 +412,15 @@ struct handle_table *copy_handle_table( struct process *process, struct process
     if (!(table = alloc_handle_table( process, parent_table->count )))
         return NULL;
 
-    if ((table->last = parent_table->last) >= 0)
+    table->last = parent_table->last;
+    table->used = table->last + 1;
+    for (i = table->last; i >= 0; i--)
     {
-        struct handle_entry *ptr = table->entries;
-        memcpy( ptr, parent_table->entries, (table->last + 1) * sizeof(struct handle_entry) );
-        for (i = 0; i <= table->last; i++, ptr++)
-        {
-            if (!ptr->ptr) continue;
-            if (ptr->access & RESERVED_INHERIT) grab_object_for_handle( ptr->ptr );
-            else ptr->ptr = NULL; /* don't inherit this entry */
-        }
+        struct handle_entry *ptr = get_entry( table, i );
+
+        *ptr = *get_entry( parent_table, i );
+        if (ptr->ptr && (ptr->access & RESERVED_INHERIT)) grab_object_for_handle( ptr->ptr );
+        else free_entry( table, i ); /* don't inherit this entry */
     }
     /* attempt to shrink the table */
     shrink_handle_table( table );
@@ -388,15 +433,24 @@ unsigned int close_handle( struct process *process, obj_handle_t handle )
     struct handle_table *table;
     struct handle_entry *entry;
     struct object *obj;
+    int index;
 
     if (!(entry = get_handle( process, handle ))) return STATUS_INVALID_HANDLE;
     if (entry->access & RESERVED_CLOSE_PROTECT) return STATUS_HANDLE_NOT_CLOSABLE;
     obj = entry->ptr;
     if (!obj->ops->close_handle( obj, process, handle )) return STATUS_HANDLE_NOT_CLOSABLE;
-    entry->ptr = NULL;
-    table = handle_is_global(handle) ? global_table : process->handles;
-    if (entry < table->entries + table->free) table->free = entry - table->entries;
-    if (entry == table->entries + table->last) shrink_handle_table( table );
+    if (handle_is_global(handle))
+    {
+        table = global_table;
+        index = handle_to_index( handle_global_to_local( handle ));
+    }
+    else
+    {
+        table = process->handles;
+        index = handle_to_index( handle );
+    }
+    free_entry( table, index );
+    if (index == table->last) shrink_handle_table( table );
     release_object_from_handle( obj );
     return STATUS_SUCCESS;
 }
@@ -476,8 +530,9 @@ obj_handle_t find_inherited_handle( struct process *process, const struct object
 
     if (!table) return 0;
 
-    for (i = 0, ptr = table->entries; i <= table->last; i++, ptr++)
+    for (i = 0; i <= table->last; i++)
     {
+        ptr = get_entry( table, i );
         if (!ptr->ptr) continue;
         if (ptr->ptr->ops != ops) continue;
         if (ptr->access & RESERVED_INHERIT) return index_to_handle(i);
@@ -496,8 +551,9 @@ obj_handle_t enumerate_handles( struct process *process, const struct object_ops
 
     if (!table) return 0;
 
-    for (i = *index, entry = &table->entries[i]; i <= table->last; i++, entry++)
+    for (i = *index; (int)i <= table->last; i++)
     {
+        entry = get_entry( table, i );
         if (!entry->ptr) continue;
         if (entry->ptr->ops != ops) continue;
         *index = i + 1;
@@ -794,8 +850,9 @@ static int enum_handles( struct process *process, void *user )
     if (!table)
         return 0;
 
-    for (i = 0, entry = table->entries; i <= table->last; i++, entry++)
+    for (i = 0; (int)i <= table->last; i++)
     {
+        entry = get_entry( table, i );
         if (!entry->ptr) continue;
         if (!info->handle)
         {
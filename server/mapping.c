@@ -875,6 +875,27 @@ struct mapping *get_mapping_obj( struct process *process, obj_handle_t handle, u
     return (struct mapping *)get_handle_obj( process, handle, access, &mapping_ops );
 }
 
+/* create an anonymous mapping that is also mapped into the server address space */
+struct mapping *create_shared_mapping( mem_size_t size, void **ptr )
+{
+    struct mapping *mapping;
+    void *base;
+
+    if (!(mapping = (struct mapping *)create_mapping( NULL, NULL, 0, size, SEC_COMMIT, 0,
+                                                       FILE_READ_DATA | FILE_WRITE_DATA, NULL )))
+        return NULL;
+
+    base = mmap( NULL, mapping->size, PROT_READ | PROT_WRITE, MAP_SHARED, get_unix_fd( mapping->fd ), 0 );
+    if (base == MAP_FAILED)
+    {
+        file_set_error();
+        release_object( mapping );
+        return NULL;
+    }
+    *ptr = base;
+    return mapping;
+}
+
 /* open a new file for the file descriptor backing the mapping */
 struct file *get_mapping_file( struct process *process, client_ptr_t base,
                                unsigned int access, unsigned int sharing )
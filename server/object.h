@@ -111,8 +111,10 @@ struct object
 struct object_name
 {
     struct list         entry;           /* entry in the hash list */
+    struct namespace   *namespace;       /* namespace containing the name */
     struct object      *obj;             /* object owning this name */
     struct object      *parent;          /* parent object */
+    unsigned int        hash;            /* case-insensitive hash of the name */
     data_size_t         len;             /* name length in bytes */
     WCHAR               name[1];
 };
@@ -141,6 +143,8 @@ extern void *open_named_object( struct object *parent, const struct object_ops *
 extern void unlink_named_object( struct object *obj );
 extern void make_object_static( struct object *obj );
 extern struct namespace *create_namespace( unsigned int hash_size );
+extern void free_namespace( struct namespace *namespace );
+extern void dump_namespace( const struct namespace *namespace );
 /* grab/release_object can take any pointer, but you better make sure */
 /* that the thing pointed to starts with a struct object... */
 extern struct object *grab_object( void *obj );
@@ -243,6 +247,7 @@ extern struct object *create_obj_symlink( struct object *root, const struct unic
 
   /* command-line options */
 extern int debug_level;
+extern int request_stats;
 extern int foreground;
 extern timeout_t master_socket_timeout;
 extern const char *server_argv0;
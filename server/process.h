@@ -96,6 +96,8 @@ struct process
     struct list          rawinput_devices;/* list of registered rawinput devices */
     const struct rawinput_device *rawinput_mouse; /* rawinput mouse device, if any */
     const struct rawinput_device *rawinput_kbd;   /* rawinput keyboard device, if any */
+    unsigned int         req_count;       /* number of requests, when collecting request stats */
+    unsigned long long   req_time;        /* time spent in its requests, in ns */
 };
 
 struct process_snapshot
@@ -28,6 +28,9 @@
 #ifdef HAVE_POLL_H
 # include <poll.h>
 #endif
+#ifdef HAVE_SYS_MMAN_H
+# include <sys/mman.h>
+#endif
 
 #include "ntstatus.h"
 #define WIN32_NO_STATUS
@@ -140,6 +143,9 @@ struct msg_queue
     struct thread_input   *input;           /* thread input descriptor */
     struct hook_table     *hooks;           /* hook table */
     timeout_t              last_get_msg;    /* time of last get message call */
+    struct mapping        *shm_mapping;     /* mapping for the state shared with the client */
+    queue_shm_t           *shm;             /* server view of the shared state */
+    struct list            shm_entry;       /* entry in the list of queues with a shared state */
 };
 
 struct hotkey
@@ -298,6 +304,8 @@ static struct msg_queue *create_msg_queue( struct thread *thread, struct thread_
         queue->input           = (struct thread_input *)grab_object( input );
         queue->hooks           = NULL;
         queue->last_get_msg    = current_time;
+        queue->shm_mapping     = NULL;
+        queue->shm             = NULL;
         list_init( &queue->send_result );
         list_init( &queue->callback_result );
         list_init( &queue->pending_timers );
@@ -440,6 +448,38 @@ void set_queue_hooks( struct thread *thread, struct hook_table *hooks )
     queue->hooks = hooks;
 }
 
+static struct list shm_queues = LIST_INIT( shm_queues );  /* queues with a shared state */
+static unsigned int hooks_serial;  /* incremented when the active hooks may have changed */
+
+/* publish the wakeup state to the client view, see get_msg_queue */
+static void update_queue_shm( struct msg_queue *queue )
+{
+    queue_shm_t *shm = queue->shm;
+    unsigned int seq;
+
+    if (!shm) return;
+    /* the client reads without locking, the sequence number is odd while fields are updated;
+     * the interlocked exchanges order the field stores between the two updates */
+    seq = shm->seq;
+    interlocked_xchg( (int *)&shm->seq, seq + 1 );
+    shm->wake_bits    = queue->wake_bits;
+    shm->changed_bits = queue->changed_bits;
+    shm->wake_mask    = queue->wake_mask;
+    shm->changed_mask = queue->changed_mask;
+    shm->hooks_serial = hooks_serial;
+    interlocked_xchg( (int *)&shm->seq, seq + 2 );
+}
+
+/* notify the clients that they need to refresh their active hooks */
+void queue_hooks_changed(void)
+{
+    struct msg_queue *queue;
+
+    hooks_serial++;
+    LIST_FOR_EACH_ENTRY( queue, &shm_queues, struct msg_queue, shm_entry )
+        update_queue_shm( queue );
+}
+
 /* check the queue status */
 static inline int is_signaled( struct msg_queue *queue )
 {
@@ -451,6 +491,7 @@ static inline void set_queue_bits( struct msg_queue *queue, unsigned int bits )
 {
     queue->wake_bits |= bits;
     queue->changed_bits |= bits;
+    update_queue_shm( queue );
     if (is_signaled( queue )) wake_up( &queue->obj, 0 );
 }
 
@@ -459,6 +500,7 @@ static inline void clear_queue_bits( struct msg_queue *queue, unsigned int bits
 {
     queue->wake_bits &= ~bits;
     queue->changed_bits &= ~bits;
+    update_queue_shm( queue );
 }
 
 /* check whether msg is a keyboard message */
@@ -968,6 +1010,7 @@ static void msg_queue_satisfied( struct object *obj, struct wait_queue_entry *en
     struct msg_queue *queue = (struct msg_queue *)obj;
     queue->wake_mask = 0;
     queue->changed_mask = 0;
+    update_queue_shm( queue );
 }
 
 static void msg_queue_destroy( struct object *obj )
@@ -1006,6 +1049,12 @@ static void msg_queue_destroy( struct object *obj )
     release_object( queue->input );
     if (queue->hooks) release_object( queue->hooks );
     if (queue->fd) release_object( queue->fd );
+    if (queue->shm) munmap( (void *)queue->shm, sizeof(*queue->shm) );
+    if (queue->shm_mapping)
+    {
+        list_remove( &queue->shm_entry );
+        release_object( queue->shm_mapping );
+    }
 }
 
 static void msg_queue_poll_event( struct fd *fd, int event )
@@ -2175,9 +2224,31 @@ DECL_HANDLER(is_window_hung)
 DECL_HANDLER(get_msg_queue)
 {
     struct msg_queue *queue = get_current_queue();
+    void *ptr;
 
     reply->handle = 0;
-    if (queue) reply->handle = alloc_handle( current->process, queue, SYNCHRONIZE, 0 );
+    reply->shm = 0;
+    if (!queue) return;
+
+    if (!queue->shm_mapping)
+    {
+        if ((queue->shm_mapping = create_shared_mapping( sizeof(*queue->shm), &ptr )))
+        {
+            queue->shm = ptr;
+            list_add_tail( &shm_queues, &queue->shm_entry );
+            update_queue_shm( queue );
+        }
+        else clear_error();  /* the shared state is optional, the client falls back to requests */
+    }
+    if (queue->shm_mapping &&
+        !(reply->shm = alloc_handle( current->process, queue->shm_mapping, SECTION_MAP_READ | SECTION_QUERY, 0 )))
+        return;
+
+    if (!(reply->handle = alloc_handle( current->process, queue, SYNCHRONIZE, 0 )) && reply->shm)
+    {
+        close_handle( current->process, reply->shm );
+        reply->shm = 0;
+    }
 }
 
 
@@ -2223,6 +2294,7 @@ DECL_HANDLER(set_queue_mask)
             if (req->skip_wait) queue->wake_mask = queue->changed_mask = 0;
             else wake_up( &queue->obj, 0 );
         }
+        update_queue_shm( queue );
     }
 }
 
@@ -2236,6 +2308,7 @@ DECL_HANDLER(get_queue_status)
         reply->wake_bits    = queue->wake_bits;
         reply->changed_bits = queue->changed_bits;
         queue->changed_bits &= ~req->clear_bits;
+        update_queue_shm( queue );
     }
     else reply->wake_bits = reply->changed_bits = 0;
 }
@@ -2412,6 +2485,7 @@ DECL_HANDLER(get_message)
     }
     if (filter & QS_INPUT) queue->changed_bits &= ~QS_INPUT;
     if (filter & QS_PAINT) queue->changed_bits &= ~QS_PAINT;
+    update_queue_shm( queue );
 
     /* then check for posted messages */
     if ((filter & QS_POSTMESSAGE) &&
@@ -2466,6 +2540,7 @@ DECL_HANDLER(get_message)
     if (get_win == -1 && current->process->idle_event) set_event( current->process->idle_event );
     queue->wake_mask = req->wake_mask;
     queue->changed_mask = req->changed_mask;
+    update_queue_shm( queue );
     set_error( STATUS_PENDING );  /* FIXME */
 }
 
@@ -292,11 +292,137 @@ static void send_reply( union generic_reply *reply )
         fatal_protocol_error( current, "reply write: %s\n", strerror( errno ));
 }
 
+/* per-request statistics */
+struct request_stats
+{
+    unsigned int       calls;          /* number of calls */
+    unsigned int       errors;         /* number of calls that failed */
+    unsigned long long time;           /* total service time, in ns */
+    unsigned long long max_time;       /* longest service time, in ns */
+    unsigned long long bytes_in;       /* request bytes received */
+    unsigned long long bytes_out;      /* reply bytes sent */
+    unsigned int       histogram[32];  /* number of calls by log2 of the service time in ns */
+};
+
+static struct request_stats req_stats[REQ_NB_REQUESTS];
+
+/* get a monotonic timestamp in ns for the request stats */
+static unsigned long long get_stats_time(void)
+{
+#ifdef __APPLE__
+    static mach_timebase_info_data_t timebase;
+
+    if (!timebase.denom) mach_timebase_info( &timebase );
+    return mach_absolute_time() * timebase.numer / timebase.denom;
+#else
+    struct timeval now;
+#ifdef HAVE_CLOCK_GETTIME
+    struct timespec ts;
+
+    if (!clock_gettime( CLOCK_MONOTONIC, &ts ))
+        return ts.tv_sec * 1000000000ull + ts.tv_nsec;
+#endif
+    gettimeofday( &now, NULL );
+    return now.tv_sec * 1000000000ull + now.tv_usec * 1000;
+#endif
+}
+
+/* account for a request that completed */
+static void add_request_stats( enum request req, struct process *process, unsigned long long time,
+                               data_size_t in_size, data_size_t out_size, unsigned int error )
+{
+    struct request_stats *stats = &req_stats[req];
+    unsigned int bucket = 0;
+
+    while (bucket < ARRAY_SIZE(stats->histogram) - 1 && (time >> (bucket + 1))) bucket++;
+    stats->calls++;
+    if (error) stats->errors++;
+    stats->time += time;
+    if (time > stats->max_time) stats->max_time = time;
+    stats->bytes_in += in_size;
+    stats->bytes_out += out_size;
+    stats->histogram[bucket]++;
+    if (process)
+    {
+        process->req_count++;
+        process->req_time += time;
+    }
+}
+
+/* return an upper bound of the 99th percentile of the service time of a request, in ns */
+static unsigned long long get_stats_p99( const struct request_stats *stats )
+{
+    unsigned int i, total = 0, limit = stats->calls - stats->calls / 100;
+
+    for (i = 0; i < ARRAY_SIZE(stats->histogram) - 1; i++)
+        if ((total += stats->histogram[i]) >= limit) break;
+    return min( 2ull << i, stats->max_time );
+}
+
+static int compare_stats_time( const void *p1, const void *p2 )
+{
+    const struct request_stats *s1 = &req_stats[*(const enum request *)p1];
+    const struct request_stats *s2 = &req_stats[*(const enum request *)p2];
+
+    if (s1->time == s2->time) return 0;
+    return s1->time < s2->time ? 1 : -1;
+}
+
+static int dump_process_stats( struct process *process, void *arg )
+{
+    if (process->req_count)
+        fprintf( stderr, "  process %04x (pid %d): %u calls, %llu us\n", process->id,
+                 process->unix_pid, process->req_count, process->req_time / 1000 );
+    process->req_count = 0;
+    process->req_time = 0;
+    return 0;
+}
+
+/* dump the request statistics to stderr and reset them */
+/* the first call starts collecting them if they weren't already */
+void dump_request_stats(void)
+{
+    enum request order[REQ_NB_REQUESTS];
+    unsigned int i;
+
+    if (!request_stats)
+    {
+        fprintf( stderr, "wineserver: starting to collect request statistics\n" );
+        request_stats = 1;
+        return;
+    }
+
+    for (i = 0; i < REQ_NB_REQUESTS; i++) order[i] = i;
+    qsort( order, REQ_NB_REQUESTS, sizeof(order[0]), compare_stats_time );
+
+    fprintf( stderr, "wineserver: request statistics\n" );
+    fprintf( stderr, "  %-32s %10s %8s %12s %8s %8s %10s %12s %12s\n", "request", "calls", "errors",
+             "total us", "avg us", "p99 us", "max us", "bytes in", "bytes out" );
+    for (i = 0; i < REQ_NB_REQUESTS; i++)
+    {
+        const struct request_stats *stats = &req_stats[order[i]];
+
+        if (!stats->calls) break;
+        fprintf( stderr, "  %-32s %10u %8u %12llu %8llu %8llu %10llu %12llu %12llu\n",
+                 get_req_name( order[i] ), stats->calls, stats->errors, stats->time / 1000,
+                 stats->time / stats->calls / 1000, get_stats_p99( stats ) / 1000,
+                 stats->max_time / 1000, stats->bytes_in, stats->bytes_out );
+    }
+    enum_processes( dump_process_stats, NULL );
+    memset( req_stats, 0, sizeof(req_stats) );
+}
+
 /* call a request handler */
 static void call_req_handler( struct thread *thread )
 {
     union generic_reply reply;
     enum request req = thread->req.request_header.req;
+    struct process *process = thread->process;
+    data_size_t req_size = thread->req.request_header.request_size;
+    data_size_t reply_size = 0;
+    unsigned long long start = 0;
+
+    if (request_stats) start = get_stats_time();
 
     current = thread;
     current->reply_size = 0;
@@ -317,6 +443,7 @@ static void call_req_handler( struct thread *thread )
             reply.reply_header.error = current->error;
             reply.reply_header.reply_size = current->reply_size;
             if (debug_level) trace_reply( req, &reply );
+            reply_size = current->reply_size;
             send_reply( &reply );
         }
         else
@@ -325,6 +452,11 @@ static void call_req_handler( struct thread *thread )
             kill_thread( current, 1 );  /* no way to continue without reply fd */
         }
     }
+    /* the thread and its process may be gone if the request killed it */
+    if (start && req < REQ_NB_REQUESTS)
+        add_request_stats( req, current ? process : NULL, get_stats_time() - start,
+                           sizeof(union generic_request) + req_size,
+                           sizeof(reply) + reply_size, reply.reply_header.error );
     current = NULL;
 }
 